@@ -3,6 +3,8 @@
 #include "lve_descriptors.hpp"
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
+#include "lve_model_loader.hpp"
+#include "lve_model_registry.hpp"
 #include "lve_renderer.hpp"
 #include "lve_buffer.hpp"
 #include "lve_window.hpp"
@@ -18,7 +20,33 @@ public:
 	static constexpr int WIDTH = 1200;
 	static constexpr int HEIGHT = 800;
 
+	enum class RenderPath {
+		// GPU driven when the device supports it
+		Auto,
+		Cpu,
+		Gpu,
+	};
+
+	struct Options {
+		RenderPath renderPath = RenderPath::Auto;
+		// compares the GPU culling counts with a CPU frustum test every frame
+		bool verifyCulling = false;
+		// spawns this many cubes in a block in front of the camera, for stress testing
+		uint32_t cubeCount = 0;
+		// once every model is resident, runs this many frames, prints the average frame time and
+		// exits; 0 runs until the window is closed
+		uint32_t benchmarkFrames = 0;
+		// workers recording the CPU path's draws; 0 uses one per hardware thread
+		uint32_t recordThreads = 0;
+		// draws every object of the CPU path on its own instead of instancing, to measure recording
+		bool separateDraws = false;
+		// imports every model with a position stream and starts with the depth prepass on, which P
+		// then toggles; without it models carry no position stream and there is no prepass
+		bool depthPrepass = false;
+	};
+
 	FirstApp();
+	explicit FirstApp(const Options &options);
 	~FirstApp();
 
 	FirstApp(const FirstApp &) = delete;
@@ -29,9 +57,13 @@ public:
 private:
 	void loadGameObjects();
 
+	Options options;
+
 	LveWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
 	LveDevice lveDevice{lveWindow};
 	LveRenderer lveRenderer{lveWindow, lveDevice};
+	LveModelLoader modelLoader{lveDevice};
+	LveModelRegistry modelRegistry{modelLoader};
 
 	// note: order of declarations matters
 	std::unique_ptr<LveDescriptorPool> globalPool{};
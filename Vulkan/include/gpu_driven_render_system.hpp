@@ -0,0 +1,210 @@
+#pragma once
+
+#include "lve_depth_pyramid.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_game_object.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_swap_chain.hpp"
+#include "simple_render_system.hpp"
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Draws a persistent set of objects with culling and LOD selection done on the GPU, so the CPU
+// cost of a frame does not grow with the scene. Transforms, colors and world-space bounds live in
+// device local buffers that only change through setObjects() and updateObject(). Every frame a
+// compute pass tests each object against the frustum and against a depth pyramid of the previous
+// frame, picks its LOD and appends compacted VkDrawIndexedIndirectCommands, which are then drawn
+// with one vkCmdDrawIndexedIndirectCount per bucket of models sharing a vertex format and geometry
+// pool buffers.
+//
+// Needs LveDevice::supportsDrawIndirectCount(). Models without indices are not drawn.
+class GpuDrivenRenderSystem {
+public:
+    GpuDrivenRenderSystem(LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    ~GpuDrivenRenderSystem();
+
+    GpuDrivenRenderSystem(const GpuDrivenRenderSystem &) = delete;
+    GpuDrivenRenderSystem &operator=(const GpuDrivenRenderSystem &) = delete;
+
+    // Uploads every object that has a model and waits for the copies. Call again whenever an object
+    // gains, loses or swaps its model; gameObjects must stay alive until then
+    void setObjects(std::vector<LveGameObject> &gameObjects);
+    // Queues the transform and color of gameObjects[index] for upload by the next cull()
+    void updateObject(uint32_t index);
+
+    // Records the culling pass; must be called outside the render pass, before render()
+    void cull(FrameInfo &frameInfo);
+    void render(FrameInfo &frameInfo);
+    // Reduces the depth buffer render() drew into the pyramid the next frame's cull() tests objects
+    // against; call after the render pass ends. The swap chain depth buffer must be sampled. The
+    // test uses the camera of this frame, so an object uncovered by camera motion shows up one frame
+    // late
+    void buildDepthPyramid(FrameInfo &frameInfo, VkImage depthImage, VkImageView depthImageView, VkFormat depthFormat);
+
+    void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+    // Drops the depth pyramid, so frames drawn by another path cannot occlude objects; occlusion
+    // culling resumes once a new pyramid has been built
+    void resetDepthPyramid() { depthPyramid.reset(); }
+
+    // Draws the culled objects depth-only from the position stream first, then shades with an
+    // EQUAL depth test, so each pixel runs the fragment shader once. The cull pass writes a second
+    // set of commands for the prepass, and both passes share the draw counts. The prepass only runs
+    // while every object's model has a position stream, since all buckets share one set of counts
+    void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+    bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+    // Largest on-screen geometric error, in pixels, allowed when picking a model LOD
+    void setMaxLodPixelError(float pixels) { maxLodPixelError = pixels; }
+
+    // Read back from the last completed frame that used the current frame index. Visible objects
+    // passed both tests; occluded ones were inside the frustum but hidden in the depth pyramid
+    uint32_t getVisibleCount() const { return visibleCount; }
+    uint32_t getOccludedCount() const { return occludedCount; }
+    uint32_t getDrawCount() const { return drawCount; }
+    uint32_t getObjectCount() const { return static_cast<uint32_t>(objectIndices.size()); }
+
+    // Checks the compute shader against the CPU: each cull() also counts the objects whose bounding
+    // sphere passes the same frustum test, and the readback of that frame has to report the same
+    // number of visible plus occluded objects. Walks every object each frame, so it is meant for
+    // validating a driver rather than for regular use
+    void setCpuReference(bool enabled) { cpuReference = enabled; }
+    // Objects in the frustum according to the CPU, for the frame the counts above were read from
+    uint32_t getReferenceCount() const { return referenceCount; }
+    uint32_t getReferenceCheckCount() const { return referenceCheckCount; }
+    uint32_t getReferenceMismatchCount() const { return referenceMismatchCount; }
+
+private:
+    using InstanceData = SimpleRenderSystem::InstanceData;
+    static constexpr uint32_t INVALID_SLOT = ~0u;
+
+    struct ObjectBounds {
+        glm::vec4 sphere;  // world-space center, radius
+        uint32_t meshIndex;
+        float maxScale;
+        uint32_t pad[2];
+    };
+
+    struct GpuMesh {
+        uint32_t firstLod;
+        uint32_t lodCount;
+        uint32_t bucket;
+        uint32_t firstCommand;
+    };
+
+    // the position stream's draws match the interleaved ones except for their vertex offsets
+    struct GpuLod {
+        float error;
+        uint32_t firstDraw;
+        uint32_t drawCount;
+        uint32_t firstPositionDraw;
+    };
+
+    // models drawn by one indirect count call per pass
+    struct Bucket {
+        VertexFormat vertexFormat;
+        VkBuffer vertexBuffer;
+        VkBuffer positionBuffer;
+        VkBuffer indexBuffer;
+        VkIndexType indexType;
+        uint32_t firstCommand;
+        uint32_t maxDrawCount;
+    };
+
+    struct CullUniformData {
+        glm::mat4 viewProjection;  // camera the pyramid's depth was rendered with
+        glm::vec2 pyramidSize;
+        uint32_t levelCount;
+        uint32_t occlusionCulling;
+        uint32_t depthPrepass;
+    };
+
+    struct StorageBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        LveAllocation allocation{};
+        VkDeviceSize size = 0;
+    };
+
+    struct FrameResources {
+        StorageBuffer commands;
+        StorageBuffer depthCommands;
+        StorageBuffer counts;
+        StorageBuffer readback;
+        StorageBuffer uniforms;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        // objectsGeneration and pyramidGeneration the buffers and descriptor set were last written for
+        uint32_t generation = 0;
+        uint32_t pyramidGeneration = 0;
+        bool pendingReadback = false;
+        uint32_t readbackBucketCount = 0;
+        // whether cull() wrote depthCommands for render()
+        bool depthPrepass = false;
+        // CPU frustum count of the frame, when setCpuReference() was on
+        bool hasReference = false;
+        uint32_t referenceCount = 0;
+    };
+
+    void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+    // shading, depth-equal and depth-only pipelines for one vertex format
+    void createPipelines(VkRenderPass renderPass, VertexFormat format);
+    void rebuild();
+    void writeObject(uint32_t slot, InstanceData &instance, ObjectBounds &bounds);
+    void uploadStorageBuffer(StorageBuffer &storage, VkBufferUsageFlags usage, const void *data, VkDeviceSize size);
+    void ensureFrameBuffer(StorageBuffer &storage, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size);
+    void prepareFrame(FrameResources &frame);
+
+    LveDevice &lveDevice;
+
+    std::unique_ptr<LvePipeline> instancedPipeline;
+    std::unique_ptr<LvePipeline> compactInstancedPipeline;
+    std::unique_ptr<LvePipeline> depthOnlyPipeline;
+    std::unique_ptr<LvePipeline> compactDepthOnlyPipeline;
+    std::unique_ptr<LvePipeline> depthEqualPipeline;
+    std::unique_ptr<LvePipeline> compactDepthEqualPipeline;
+    std::unique_ptr<LvePipeline> cullPipeline;
+    VkPipelineLayout pipelineLayout;
+    VkPipelineLayout cullPipelineLayout;
+    std::unique_ptr<LveDescriptorSetLayout> cullSetLayout;
+    std::unique_ptr<LveDescriptorPool> cullPool;
+
+    std::vector<LveGameObject> *gameObjects = nullptr;
+    // game object index of every uploaded object, and the reverse mapping
+    std::vector<uint32_t> objectIndices;
+    std::vector<uint32_t> objectSlots;
+    std::vector<uint32_t> objectMeshes;
+    std::vector<uint32_t> dirtySlots;
+    std::vector<Bucket> buckets;
+    uint32_t commandCapacity = 0;
+
+    StorageBuffer instanceBuffer;
+    StorageBuffer boundsBuffer;
+    StorageBuffer meshBuffer;
+    StorageBuffer lodBuffer;
+    StorageBuffer drawBuffer;
+    std::array<FrameResources, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+    uint32_t objectsGeneration = 1;
+    uint32_t geometryGeneration = 0;
+
+    std::unique_ptr<LveDepthPyramid> depthPyramid;
+    uint32_t pyramidGeneration = 0;
+    bool occlusionCulling = true;
+    bool depthPrepass = false;
+    bool positionStreams = true;  // every uploaded model can be drawn in the prepass
+
+    float maxLodPixelError = 1.f;
+    uint32_t visibleCount = 0;
+    uint32_t occludedCount = 0;
+    uint32_t drawCount = 0;
+
+    bool cpuReference = false;
+    uint32_t referenceCount = 0;
+    uint32_t referenceCheckCount = 0;
+    uint32_t referenceMismatchCount = 0;
+};
+}  // namespace lve
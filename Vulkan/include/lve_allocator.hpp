@@ -0,0 +1,159 @@
+#pragma once
+
+#include "lve_free_list.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// What an allocation is used for, so memory use can be broken down per system
+enum class LveMemoryCategory { Geometry, Staging, Uniform, Texture, RenderTarget, Other };
+constexpr uint32_t LVE_MEMORY_CATEGORY_COUNT = 6;
+const char *getMemoryCategoryName(LveMemoryCategory category);
+
+// A range of device memory handed out by LveAllocator. Host visible allocations are persistently
+// mapped and mappedData points at the first byte of the range
+struct LveAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  void *mappedData = nullptr;
+  uint32_t poolIndex = 0;
+  bool dedicated = false;
+  LveMemoryCategory category = LveMemoryCategory::Other;
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks so the number of driver
+// allocations stays far below maxMemoryAllocationCount. Every memory type gets one pool for
+// buffers and one for optimal tiling images, which keeps bufferImageGranularity out of the
+// placement logic. Each block places allocations with an LveFreeList. Resources at least half a
+// block in size, and everything in lazily allocated memory, get their own dedicated allocation.
+//
+// Device memory is tracked per heap and per LveMemoryCategory. With VK_EXT_memory_budget the heap
+// budgets come from the driver; a soft budget below them lets streaming systems back off through
+// isWithinSoftBudget() before an allocation fails.
+class LveAllocator {
+ public:
+  static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+  static constexpr float DEFAULT_SOFT_BUDGET_FRACTION = 0.9f;
+
+  enum class ResourceType { Buffer, Image };
+
+  struct Stats {
+    uint32_t blockCount = 0;
+    uint32_t dedicatedAllocationCount = 0;
+    uint32_t allocationCount = 0;
+    // VkDeviceMemory objects alive, the number limited by maxMemoryAllocationCount
+    uint32_t deviceMemoryCount = 0;
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    // bytes handed out from blocks; blockBytes minus this is free or alignment padding
+    VkDeviceSize usedBlockBytes = 0;
+  };
+
+  // Without VK_EXT_memory_budget, budget is 80% of the heap and usage is this allocator's own
+  // device memory; with it both cover every process using the heap
+  struct HeapBudget {
+    VkMemoryHeapFlags flags = 0;
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    VkDeviceSize softBudget = 0;
+    // VkDeviceMemory owned by this allocator
+    VkDeviceSize deviceMemoryBytes = 0;
+    // bytes of live resources, without block slack
+    VkDeviceSize categoryBytes[LVE_MEMORY_CATEGORY_COUNT] = {};
+  };
+
+  LveAllocator(VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudgetSupported = false);
+  ~LveAllocator();
+
+  LveAllocator(const LveAllocator &) = delete;
+  LveAllocator &operator=(const LveAllocator &) = delete;
+
+  LveAllocation allocate(
+      const VkMemoryRequirements &requirements,
+      VkMemoryPropertyFlags properties,
+      ResourceType type,
+      LveMemoryCategory category = LveMemoryCategory::Other);
+  void free(LveAllocation &allocation);
+
+  // Ranges are relative to the allocation; both are no-ops on host coherent memory
+  VkResult flush(const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size);
+  VkResult invalidate(const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size);
+
+  uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+  bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+  VkMemoryPropertyFlags getMemoryProperties(const LveAllocation &allocation) const {
+    return memoryProperties.memoryTypes[allocation.poolIndex / 2].propertyFlags;
+  }
+  Stats getStats() const;
+
+  // Size of the blocks sub-allocated for a memory type; requests of at least half of it get a
+  // dedicated allocation
+  VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+  // The nonCoherentAtomSize aligned range flush() and invalidate() hand to the driver
+  VkMappedMemoryRange makeMappedRange(
+      const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+  // Re-queries the driver budgets; call once per frame
+  void updateBudget();
+  std::vector<HeapBudget> getHeapBudgets() const;
+  // Whether size more bytes in the heap backing these properties stay under the soft budget
+  bool isWithinSoftBudget(VkMemoryPropertyFlags properties, VkDeviceSize size) const;
+  void setSoftBudgetFraction(float fraction);
+  bool hasMemoryBudgetExtension() const { return memoryBudgetSupported; }
+
+ private:
+  struct Block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;
+    LveFreeList freeList;
+    uint32_t allocationCount = 0;
+  };
+
+  struct Pool {
+    std::vector<std::unique_ptr<Block>> blocks;
+  };
+
+  struct HeapState {
+    VkDeviceSize deviceMemoryBytes = 0;
+    VkDeviceSize categoryBytes[LVE_MEMORY_CATEGORY_COUNT] = {};
+    // driver values from the last updateBudget() and our own usage at that time, so usage
+    // between queries is extrapolated from what this allocator did since
+    VkDeviceSize queriedBudget = 0;
+    VkDeviceSize queriedUsage = 0;
+    VkDeviceSize deviceMemoryBytesAtQuery = 0;
+  };
+
+  VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped);
+  void freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex);
+  HeapBudget makeHeapBudget(uint32_t heapIndex) const;
+  uint32_t getHeapIndex(uint32_t memoryTypeIndex) const {
+    return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  }
+  bool allocateFromBlock(Block &block, VkDeviceSize size, VkDeviceSize alignment, LveAllocation &allocation);
+  bool isCoherent(uint32_t memoryTypeIndex) const;
+
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkDeviceSize nonCoherentAtomSize;
+  bool memoryBudgetSupported;
+  float softBudgetFraction = DEFAULT_SOFT_BUDGET_FRACTION;
+
+  mutable std::mutex mutex;
+  Pool pools[VK_MAX_MEMORY_TYPES * 2];
+  HeapState heaps[VK_MAX_MEMORY_HEAPS];
+  Stats stats{};
+};
+
+}  // namespace lve
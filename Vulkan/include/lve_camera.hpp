@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 
 #include "keyboard_movement_controller.hpp"
+#include "lve_culling.hpp"
 
 namespace lve {
 
@@ -22,12 +23,17 @@ class LveCamera {
 
   const glm::mat4& getProjection() const { return projectionMatrix; }
   const glm::mat4& getView() const { return viewMatrix; }
+  const glm::mat4& getInverseView() const { return inverseViewMatrix; }
+  const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+  // World-space view frustum of the current projection and view
+  Frustum getFrustum() const { return Frustum::fromMatrix(projectionMatrix * viewMatrix); }
 
   TransformComponent transform{};
 
  private:
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 viewMatrix{1.f};
+  glm::mat4 inverseViewMatrix{1.f};
   
   KeyboardMovementController controller{};
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace lve {
+
+// Records the contents of a render pass on several threads into secondary command buffers. Each
+// worker slot owns one command pool per frame in flight, so no pool is ever used by two threads
+// at once and a frame's pools are reset wholesale once its fence has signaled. A slot is recorded
+// by exactly one thread per record() call, whichever pool thread picks it up.
+//
+// The primary command buffer must begin the render pass with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+class LveCommandRecorder {
+ public:
+  // slots beyond the pool's threads run on the calling thread
+  explicit LveCommandRecorder(LveDevice &device, uint32_t workerCount = LveThreadPool::defaultThreadCount() + 1);
+  ~LveCommandRecorder();
+
+  LveCommandRecorder(const LveCommandRecorder &) = delete;
+  LveCommandRecorder &operator=(const LveCommandRecorder &) = delete;
+
+  uint32_t getWorkerCount() const { return workerCount; }
+
+  // Resets the frame's pools; call after LveRenderer::beginFrame has waited on the frame's fence
+  void beginFrame(int frameIndex);
+
+  // Calls record(worker, commandBuffer) for every worker in [0, taskCount) in parallel, each with a
+  // secondary command buffer continuing subpass 0 of renderPass with the viewport and scissor set
+  // to extent, then executes the buffers in worker order in primaryCommandBuffer. renderPass and
+  // framebuffer must be the ones the primary began; the framebuffer may be VK_NULL_HANDLE, but
+  // naming it lets the driver specialize the secondaries
+  void record(
+      VkCommandBuffer primaryCommandBuffer,
+      VkRenderPass renderPass,
+      VkFramebuffer framebuffer,
+      VkExtent2D extent,
+      uint32_t taskCount,
+      const std::function<void(uint32_t worker, VkCommandBuffer commandBuffer)> &record);
+
+ private:
+  struct Worker {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> commandBuffers;
+    // buffers handed out since the pool was last reset
+    uint32_t usedCount = 0;
+  };
+
+  VkCommandBuffer acquireCommandBuffer(Worker &worker);
+
+  LveDevice &lveDevice;
+  uint32_t workerCount;
+  LveThreadPool threadPool;
+  std::array<std::vector<Worker>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+  int currentFrameIndex = 0;
+  std::vector<VkCommandBuffer> recorded;
+};
+
+}  // namespace lve
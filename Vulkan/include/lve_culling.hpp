@@ -0,0 +1,54 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// View frustum as six inward-facing planes (xyz = unit normal, w = distance), in the space the
+// source matrix maps from: pass projection * view for world space, or projection * view * model
+// to test model-space bounds without transforming them.
+struct Frustum {
+  enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+  glm::vec4 planes[PLANE_COUNT];
+
+  // Gribb-Hartmann plane extraction for a Vulkan style [0, 1] depth range
+  static Frustum fromMatrix(const glm::mat4 &matrix);
+
+  bool intersectsSphere(const glm::vec3 &center, float radius) const;
+};
+
+// World-space bounding boxes of many objects, kept as separate center and extent arrays so the
+// frustum test runs on 8 boxes at a time with AVX, or 4 with SSE, and falls back to scalar code
+// for the remainder or when neither is enabled at compile time. The x64 configurations build with
+// /arch:AVX; cullListMillionBoxes in LveTests measures the pass.
+class LveCullList {
+ public:
+  void clear();
+  void reserve(uint32_t capacity);
+  // Adds the world-axis-aligned box enclosing the model-space box [boxMin, boxMax] after transform
+  void add(const glm::mat4 &transform, const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+  uint32_t size() const { return static_cast<uint32_t>(centerX.size()); }
+
+  // Writes the indices, in order, of the boxes intersecting the frustum and returns how many there
+  // are; visible needs room for size() entries
+  uint32_t cull(const Frustum &frustum, uint32_t *visible) const;
+
+ private:
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+};
+
+// True when every triangle inside a normal cone faces away from the viewer. apex is a point behind
+// all the triangles along the cone axis and cutoff is the sine of the cone's half angle; a cutoff
+// above 1 marks a cone too wide to ever be culled.
+bool isConeBackfacing(const glm::vec3 &apex, const glm::vec3 &axis, float cutoff, const glm::vec3 &viewPosition);
+
+}  // namespace lve
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_allocator.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+class LveDevice;
+
+// Postpones destroying GPU objects until every frame that may have recorded a reference to them
+// has finished. Each entry is tagged with the frame being recorded when it was queued; LveRenderer
+// calls beginFrame() once the fence of the next frame slot has signaled, which proves every frame
+// up to MAX_FRAMES_IN_FLIGHT back is complete, and the entries of those frames are run then.
+//
+// Safe to queue from any thread.
+class LveDeletionQueue {
+ public:
+  explicit LveDeletionQueue(LveDevice &device);
+  // Waits for the device and runs everything still queued
+  ~LveDeletionQueue();
+
+  LveDeletionQueue(const LveDeletionQueue &) = delete;
+  LveDeletionQueue &operator=(const LveDeletionQueue &) = delete;
+
+  void enqueue(std::function<void()> destroy);
+  void destroyBuffer(VkBuffer buffer, LveAllocation allocation);
+  void destroyImage(VkImage image, LveAllocation allocation);
+  void destroyImageView(VkImageView imageView);
+  void destroyPipeline(VkPipeline pipeline);
+  void freeDescriptorSets(VkDescriptorPool descriptorPool, std::vector<VkDescriptorSet> descriptorSets);
+
+  // Keeps the object alive until the frames that may use it are done
+  template <typename T>
+  void retire(std::shared_ptr<T> object) {
+    enqueue([object]() mutable { object.reset(); });
+  }
+  template <typename T>
+  void retire(std::unique_ptr<T> object) {
+    retire(std::shared_ptr<T>{std::move(object)});
+  }
+
+  // Call once the fence of the frame about to be recorded has been waited on
+  void beginFrame();
+  // Runs everything queued; only valid while the device is idle
+  void collectAll();
+
+  size_t getPendingCount() const;
+
+ private:
+  struct Entry {
+    uint64_t frame;
+    std::function<void()> destroy;
+  };
+
+  LveDevice &lveDevice;
+
+  mutable std::mutex mutex;
+  std::deque<Entry> entries;
+  uint64_t frame = 0;
+};
+
+}  // namespace lve
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Hierarchical-Z buffer: a mip chain of a depth buffer where every texel holds the farthest depth
+// of the pixels it covers. Level 0 is the depth buffer's size rounded down to powers of two, so
+// each later level halves exactly. An object whose nearest depth lies behind the pyramid over its
+// whole screen footprint, as seen by the camera the depth was rendered with, is hidden.
+//
+// Every level stays in VK_IMAGE_LAYOUT_GENERAL; readers sample it with texelFetch through
+// getDescriptorInfo().
+class LveDepthPyramid {
+ public:
+  LveDepthPyramid(LveDevice &device, VkExtent2D depthExtent);
+  ~LveDepthPyramid();
+
+  LveDepthPyramid(const LveDepthPyramid &) = delete;
+  LveDepthPyramid &operator=(const LveDepthPyramid &) = delete;
+
+  // Reduces the depth buffer written by the render pass that just ended in commandBuffer. The depth
+  // image must have been created with VK_IMAGE_USAGE_SAMPLED_BIT and is handed back in
+  // VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL. viewProjection is the camera it was rendered
+  // with. Compute reads recorded after this call, in this or later command buffers, see the result
+  void build(
+      VkCommandBuffer commandBuffer,
+      VkImage depthImage,
+      VkImageView depthImageView,
+      VkFormat depthFormat,
+      const glm::mat4 &viewProjection);
+
+  VkDescriptorImageInfo getDescriptorInfo() const;
+  VkExtent2D getDepthExtent() const { return depthExtent; }
+  VkExtent2D getExtent() const { return extent; }
+  uint32_t getLevelCount() const { return static_cast<uint32_t>(levelViews.size()); }
+  // False until the first build(); the contents are undefined before then
+  bool isValid() const { return valid; }
+  const glm::mat4 &getViewProjection() const { return viewProjection; }
+
+ private:
+  void createImage();
+  void createDescriptors();
+  void createPipeline();
+
+  LveDevice &lveDevice;
+  VkExtent2D depthExtent;
+  VkExtent2D extent;
+
+  VkImage image = VK_NULL_HANDLE;
+  LveAllocation imageAllocation{};
+  VkImageView imageView = VK_NULL_HANDLE;
+  std::vector<VkImageView> levelViews;
+  VkSampler sampler = VK_NULL_HANDLE;
+
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  std::unique_ptr<LveDescriptorPool> descriptorPool;
+  // set i reduces into level i; set 0 reads the depth buffer
+  std::vector<VkDescriptorSet> levelSets;
+  VkImageView boundDepthView = VK_NULL_HANDLE;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<LvePipeline> reducePipeline;
+
+  bool valid = false;
+  glm::mat4 viewProjection{1.f};
+};
+
+}  // namespace lve
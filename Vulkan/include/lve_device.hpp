@@ -1,13 +1,19 @@
 #pragma once
 
+#include "lve_allocator.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+class LveDeletionQueue;
+class LveGeometryPool;
+class LveUploadContext;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,8 +23,11 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  // a family with transfer but no graphics support, when the device has one
+  uint32_t transferFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -44,12 +53,25 @@ class LveDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // the graphics queue when the device has no dedicated transfer family
+  VkQueue transferQueue() { return transferQueue_; }
+  bool hasDedicatedTransferQueue() const { return transferQueue_ != graphicsQueue_; }
+  // VK_KHR_draw_indirect_count together with multiDrawIndirect and drawIndirectFirstInstance
+  bool supportsDrawIndirectCount() const { return cmdDrawIndexedIndirectCount_ != nullptr; }
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const { return cmdDrawIndexedIndirectCount_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  bool isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+  LveAllocator &getAllocator() { return *allocator; }
+  // Destroy anything a frame in flight may still use through this
+  LveDeletionQueue &getDeletionQueue() { return *deletionQueue; }
+  LveUploadContext &getUploadContext() { return *uploadContext; }
+  LveGeometryPool &getGeometryPool() { return *geometryPool; }
 
   // Buffer Helper Functions
   void createBuffer(
@@ -57,18 +79,23 @@ class LveDevice {
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      LveAllocation &bufferAllocation,
+      bool shareWithTransferQueue = false);
+  void destroyBuffer(VkBuffer buffer, LveAllocation &bufferAllocation);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
+  // preferredProperties are added to properties when the image can live in such memory
   void createImageWithInfo(
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      LveAllocation &imageAllocation,
+      VkMemoryPropertyFlags preferredProperties = 0);
+  void destroyImage(VkImage image, LveAllocation &imageAllocation);
 
   VkPhysicalDeviceProperties properties;
 
@@ -88,6 +115,7 @@ class LveDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
@@ -100,6 +128,14 @@ class LveDevice {
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  bool memoryBudgetSupported = false;
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
+
+  std::unique_ptr<LveAllocator> allocator;
+  std::unique_ptr<LveDeletionQueue> deletionQueue;
+  std::unique_ptr<LveUploadContext> uploadContext;
+  std::unique_ptr<LveGeometryPool> geometryPool;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// Bump allocator for data that lives for a single frame, such as per-pass and per-draw uniforms
+// that do not fit in push constants. One persistently mapped buffer is split into a region per
+// frame in flight; allocations hand out a pointer to write through and the offset to pass as the
+// dynamic offset of a UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC descriptor, so the same
+// descriptor set serves every allocation and every frame.
+//
+// A frame that outgrows its region spills into overflow buffers kept for that frame, and the next
+// beginFrame() replaces the buffer with one whose regions fit the largest frame seen. Descriptors
+// can only reach the main buffer, so allocations meant for them should be made first in the frame;
+// spilled allocations are still fine as vertex or index data bound at Allocation::buffer. Sets
+// written from descriptorInfo() have to be rewritten when getGeneration() changes.
+//
+// Call beginFrame() once the frame's fence has signaled, which LveRenderer::beginFrame guarantees,
+// and flush() before the frame's command buffer is submitted.
+class LveFrameAllocator {
+ public:
+  static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4ull * 1024 * 1024;
+
+  struct Allocation {
+    void *data;
+    // offset within buffer, which is also the dynamic offset when buffer is the main buffer
+    uint32_t dynamicOffset;
+    VkBuffer buffer;
+  };
+
+  explicit LveFrameAllocator(
+      LveDevice &device,
+      VkDeviceSize frameSize = DEFAULT_FRAME_SIZE,
+      VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  LveFrameAllocator(const LveFrameAllocator &) = delete;
+  LveFrameAllocator &operator=(const LveFrameAllocator &) = delete;
+
+  void beginFrame(int frameIndex);
+  Allocation allocate(VkDeviceSize size);
+  template <typename T>
+  Allocation push(const T &value) {
+    Allocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+  void flush();
+
+  // Descriptor covering range bytes at the start of the buffer, to be moved by dynamic offsets
+  VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) { return buffer->descriptorInfo(range, 0); }
+  VkBuffer getBuffer() const { return buffer->getBuffer(); }
+  // Bumped each time the main buffer is replaced
+  uint64_t getGeneration() const { return generation; }
+  VkDeviceSize getFrameSize() const { return frameSize; }
+  // Bytes handed out in the current frame, including alignment padding and overflow
+  VkDeviceSize getUsedBytes() const { return demand; }
+  uint32_t getGrowCount() const { return growCount; }
+
+ private:
+  void createBuffer();
+  Allocation allocateOverflow(VkDeviceSize size);
+
+  LveDevice &lveDevice;
+  VkBufferUsageFlags usage;
+  std::unique_ptr<LveBuffer> buffer;
+  VkDeviceSize frameSize;
+  VkDeviceSize alignment;
+  VkDeviceSize frameBegin = 0;
+  VkDeviceSize head = 0;
+  uint64_t generation = 0;
+  uint32_t growCount = 0;
+
+  // spilled allocations of each frame slot, released once the slot comes around again
+  int currentFrame = 0;
+  std::array<std::vector<std::unique_ptr<LveBuffer>>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> overflow;
+  VkDeviceSize overflowHead = 0;
+  VkDeviceSize demand = 0;
+  VkDeviceSize peakDemand = 0;
+};
+
+}  // namespace lve
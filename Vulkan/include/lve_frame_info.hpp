@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_frame_allocator.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -12,6 +13,14 @@ struct FrameInfo {
 	VkCommandBuffer commandBuffer;
 	LveCamera& camera;
 	VkDescriptorSet globalDescriptorSet;
+	// dynamic offset of this frame's GlobalUbo within globalDescriptorSet
+	uint32_t globalUboOffset;
+	LveFrameAllocator& frameAllocator;
+	VkExtent2D extent;
+	// the swap chain render pass and the framebuffer it renders to this frame; both change when
+	// the swap chain is recreated
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
 };
 
 }
\ No newline at end of file
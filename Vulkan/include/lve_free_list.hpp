@@ -0,0 +1,30 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <map>
+
+namespace lve {
+
+// Best fit placement of ranges inside [0, capacity), with neighbouring free ranges merged on
+// release. Units are up to the caller: bytes for device memory blocks, elements for the
+// geometry pool.
+class LveFreeList {
+ public:
+  explicit LveFreeList(uint64_t capacity = 0);
+
+  bool allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+  void free(uint64_t offset, uint64_t size);
+
+  uint64_t getCapacity() const { return capacity; }
+  uint64_t getFreeSize() const { return freeSize; }
+  uint64_t getLargestFreeRange() const;
+
+ private:
+  // offset -> size of each free range
+  std::map<uint64_t, uint64_t> freeRanges;
+  uint64_t capacity;
+  uint64_t freeSize;
+};
+
+}  // namespace lve
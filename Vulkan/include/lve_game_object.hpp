@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_model.hpp"
+#include "lve_model_loader.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
@@ -42,6 +43,8 @@ public:
     void update(float dt);
 
     std::shared_ptr<LveModel> model{};
+    // set while the model is still streaming in; model stays null until it is resident
+    std::shared_ptr<LveModelHandle> pendingModel{};
     glm::vec3 color{0.f};
     TransformComponent transform{};
 
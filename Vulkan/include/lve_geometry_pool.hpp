@@ -0,0 +1,116 @@
+#pragma once
+
+#include "lve_free_list.hpp"
+#include "lve_upload_context.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Sub-allocates the vertices and indices of every model out of a few large device local buffers,
+// one per vertex stride and one per index type, so a frame binds geometry once and draws with
+// offsets. Ranges are addressed by stable ids whose element offsets change when an arena grows
+// or is compacted, so offsets are looked up when recording draws rather than cached.
+//
+// Growing or compacting an arena waits for pending uploads, copies the live ranges into a new
+// buffer and hands the old one to the device's deletion queue. Freed ranges likewise only become
+// reusable once no frame in flight can still draw from them.
+class LveGeometryPool {
+ public:
+  using RangeId = uint32_t;
+  static constexpr RangeId INVALID_RANGE = ~0u;
+
+  static constexpr VkDeviceSize DEFAULT_VERTEX_ARENA_SIZE = 64ull * 1024 * 1024;
+  static constexpr VkDeviceSize DEFAULT_INDEX_ARENA_SIZE = 32ull * 1024 * 1024;
+
+  // A range about to be allocated, for estimating what placing it would cost beforehand
+  struct Request {
+    VkBufferUsageFlags usage;
+    uint32_t stride;
+    uint32_t count;
+
+    static Request vertices(uint32_t stride, uint32_t count) { return {VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, stride, count}; }
+    static Request indices(VkIndexType indexType, uint32_t count);
+    VkDeviceSize getSize() const { return static_cast<VkDeviceSize>(count) * stride; }
+  };
+
+  struct Stats {
+    uint32_t arenaCount = 0;
+    uint32_t rangeCount = 0;
+    VkDeviceSize capacityBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t growCount = 0;
+    uint32_t compactCount = 0;
+    // freed but still counted in usedBytes until frames in flight are done with them
+    VkDeviceSize pendingFreeBytes = 0;
+  };
+
+  explicit LveGeometryPool(LveDevice &device);
+  ~LveGeometryPool();
+
+  LveGeometryPool(const LveGeometryPool &) = delete;
+  LveGeometryPool &operator=(const LveGeometryPool &) = delete;
+
+  // Copy count elements into the pool through uploadContext; the data is usable once the
+  // context's next flush() token completes
+  RangeId allocateVertices(uint32_t stride, uint32_t count, const void *data, LveUploadContext &uploadContext);
+  RangeId allocateIndices(VkIndexType indexType, uint32_t count, const void *data, LveUploadContext &uploadContext);
+  // The range stays valid for frames already recorded
+  void free(RangeId range);
+
+  // Offset in elements of the range inside its arena buffer
+  uint32_t getOffset(RangeId range) const { return ranges[range].offset; }
+  VkDeviceSize getSize(RangeId range) const;
+  VkBuffer getBuffer(RangeId range) const { return arenas[ranges[range].arena].buffer; }
+  // Changes whenever a grow or compaction moves ranges, invalidating saved offsets and buffers
+  uint32_t getGeneration() const { return generation; }
+
+  // Packs every arena whose free space is mostly fragmented
+  void compact();
+
+  // Device memory that allocating the requests in order would add. Only the arenas they land in
+  // count, and an arena that has to grow or compact gets a whole new buffer while the old one
+  // stays alive in the deletion queue for the frames in flight, so each relocation adds its full
+  // new capacity. Pending frees are not counted on, which errs on the high side
+  VkDeviceSize estimateGrowth(const std::vector<Request> &requests) const;
+
+  Stats getStats() const;
+
+ private:
+  struct Arena {
+    VkBufferUsageFlags usage;
+    uint32_t stride;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    LveAllocation allocation{};
+    LveFreeList freeList;
+  };
+
+  struct Range {
+    uint32_t arena;
+    uint32_t offset;
+    uint32_t count;
+  };
+
+  RangeId allocate(VkBufferUsageFlags usage, uint32_t stride, uint32_t count, const void *data, LveUploadContext &uploadContext);
+  uint32_t findOrCreateArena(VkBufferUsageFlags usage, uint32_t stride, uint32_t minCount);
+  static uint64_t getInitialCapacity(VkBufferUsageFlags usage, uint32_t stride, uint32_t minCount);
+  // Capacity a full arena is relocated to so that count more elements fit
+  static uint64_t getRelocatedCapacity(uint64_t capacity, uint64_t liveCount, uint32_t count);
+  void createArenaBuffer(Arena &arena, uint64_t capacity);
+  // Moves every live range of the arena to the front of a new buffer holding capacity elements
+  void relocate(uint32_t arenaIndex, uint64_t capacity, LveUploadContext &uploadContext);
+  void release(RangeId range);
+
+  LveDevice &lveDevice;
+  std::vector<Arena> arenas;
+  std::vector<Range> ranges;
+  std::vector<RangeId> freeRangeIds;
+  uint32_t growCount = 0;
+  uint32_t compactCount = 0;
+  uint32_t generation = 0;
+  VkDeviceSize pendingFreeBytes = 0;
+};
+
+}  // namespace lve
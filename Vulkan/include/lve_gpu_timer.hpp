@@ -0,0 +1,42 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+
+namespace lve {
+
+// Measures the GPU time of a stretch of a frame's command buffer with a pair of timestamps. Each
+// frame in flight owns its own two queries, so the result read at the start of a frame is the
+// one the same slot wrote MAX_FRAMES_IN_FLIGHT frames ago, once its fence has signaled.
+class LveGpuTimer {
+ public:
+  explicit LveGpuTimer(LveDevice &device);
+  ~LveGpuTimer();
+
+  LveGpuTimer(const LveGpuTimer &) = delete;
+  LveGpuTimer &operator=(const LveGpuTimer &) = delete;
+
+  // Reads the frame's previous measurement; call after LveRenderer::beginFrame has waited on the
+  // frame's fence and before begin()
+  void beginFrame(int frameIndex);
+
+  // Outside a render pass, around the work to time
+  void begin(VkCommandBuffer commandBuffer, int frameIndex);
+  void end(VkCommandBuffer commandBuffer, int frameIndex);
+
+  // Milliseconds of the latest completed measurement, 0 until there is one or when the queue
+  // has no timestamp support
+  double getMilliseconds() const { return milliseconds; }
+
+ private:
+  LveDevice &lveDevice;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  std::array<bool, LveSwapChain::MAX_FRAMES_IN_FLIGHT> written{};
+  double nanosecondsPerTick = 0.0;
+  double milliseconds = 0.0;
+};
+
+}  // namespace lve
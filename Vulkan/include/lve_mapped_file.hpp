@@ -0,0 +1,33 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+namespace lve {
+
+// Read-only memory mapping of a whole file. The view stays valid for the lifetime of the object.
+class LveMappedFile {
+ public:
+  explicit LveMappedFile(const std::string &filepath);
+  ~LveMappedFile();
+
+  LveMappedFile(const LveMappedFile &) = delete;
+  LveMappedFile &operator=(const LveMappedFile &) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mappingHandle = nullptr;
+#else
+  int fileDescriptor = -1;
+#endif
+};
+
+}  // namespace lve
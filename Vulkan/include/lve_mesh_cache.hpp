@@ -0,0 +1,57 @@
+#pragma once
+
+#include "lve_model.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace lve {
+
+// Binary cache of imported meshes, written beside the source file as "<source>.lvemesh".
+//
+// Layout: LveMeshCache::Header, followed by one 16-byte aligned block per section at the offsets
+// stored in the header. A cache is only used when the recorded size and modification time of the
+// source file still match, and when it was built with the same geometry-affecting import options.
+class LveMeshCache {
+ public:
+  static constexpr uint32_t MAGIC = 0x4853454c;  // "LESH"
+  static constexpr uint32_t VERSION = 4;
+
+  enum SectionId : uint32_t {
+    SECTION_VERTICES,
+    SECTION_INDICES,
+    SECTION_LODS,
+    SECTION_MESHLETS,
+    SECTION_COUNT,
+  };
+
+  struct Section {
+    uint64_t offset;
+    uint32_t count;
+    uint32_t stride;
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint64_t optionsKey;
+    Section sections[SECTION_COUNT];
+  };
+
+  static std::string cachePathFor(const std::string &sourcePath);
+
+  // Folds the import options that change the produced geometry into a single value
+  static uint64_t optionsKey(const ModelImportOptions &options);
+
+  // Returns false if there is no valid cache for sourcePath, leaving the builder untouched
+  static bool load(const std::string &sourcePath, const ModelImportOptions &options, LveModel::Builder &builder);
+
+  // Returns false if the cache could not be written, e.g. because the directory is read-only
+  static bool store(
+      const std::string &sourcePath, const ModelImportOptions &options, const LveModel::Builder &builder);
+};
+
+}  // namespace lve
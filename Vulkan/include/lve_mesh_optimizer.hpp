@@ -0,0 +1,63 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Post-transform vertex cache statistics from a FIFO cache simulation.
+// ACMR is transformed vertices per triangle (0.5 is the ideal for a regular grid, 3 the worst),
+// ATVR is transformed vertices per referenced vertex (1.0 is the ideal).
+struct VertexCacheStats {
+  uint32_t transformedVertices = 0;
+  float acmr = 0.f;
+  float atvr = 0.f;
+};
+
+// Index and vertex reordering passes for triangle lists, following Sander et al., "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw" (Tipsify):
+//  1. optimizeVertexCache reorders triangles for the post-transform cache and reports the
+//     cache-flush points as cluster boundaries
+//  2. optimizeOverdraw splits those clusters further where it costs little cache efficiency and
+//     sorts them so outward-facing clusters are drawn first
+//  3. optimizeVertexFetch renumbers vertices in first-use order for linear vertex fetches
+// Passes 1 and 2 only permute triangles; pass 3 also rewrites the vertex array.
+class LveMeshOptimizer {
+ public:
+  static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+  // Reorders triangles in place. clusters, if given, receives the first triangle of each cluster
+  static void optimizeVertexCache(
+      std::vector<uint32_t> &indices,
+      size_t vertexCount,
+      uint32_t cacheSize = DEFAULT_CACHE_SIZE,
+      std::vector<uint32_t> *clusters = nullptr);
+
+  // Reorders the clusters produced by optimizeVertexCache in place. positions points at the xyz of
+  // the first vertex and consecutive vertices are positionStride bytes apart. A threshold of 1.05
+  // allows clusters to be split wherever the local ACMR stays within 5% of the cluster's ACMR
+  static void optimizeOverdraw(
+      std::vector<uint32_t> &indices,
+      const std::vector<uint32_t> &clusters,
+      const float *positions,
+      size_t positionStride,
+      size_t vertexCount,
+      float threshold = 1.05f,
+      uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+  // Moves vertices into first-use order and drops unreferenced ones. Returns the new vertex count
+  static size_t optimizeVertexFetch(
+      void *vertices, size_t vertexCount, size_t vertexStride, std::vector<uint32_t> &indices);
+
+  template <typename T>
+  static void optimizeVertexFetch(std::vector<T> &vertices, std::vector<uint32_t> &indices) {
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), sizeof(T), indices));
+  }
+
+  static VertexCacheStats analyzeVertexCache(
+      const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+};
+
+}  // namespace lve
@@ -0,0 +1,32 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Quadric error metric simplification (Garland & Heckbert) by edge collapse onto existing
+// vertices, so every simplified index list can share the vertex buffer of the source mesh.
+//
+// Vertices on open borders, non-manifold edges and attribute seams (several vertices sharing one
+// position) are never moved, which keeps silhouettes and texture seams intact at the cost of some
+// reduction on heavily seamed meshes.
+class LveMeshSimplifier {
+ public:
+  // Collapses edges in order of increasing error until at most targetIndexCount indices remain or
+  // the next collapse would exceed maxError. positions points at the xyz of the first vertex and
+  // consecutive vertices are positionStride bytes apart. resultError, if given, receives the
+  // largest error introduced, as a distance in model units
+  static std::vector<uint32_t> simplify(
+      const std::vector<uint32_t> &indices,
+      const float *positions,
+      size_t positionStride,
+      size_t vertexCount,
+      size_t targetIndexCount,
+      float maxError,
+      float *resultError = nullptr);
+};
+
+}  // namespace lve
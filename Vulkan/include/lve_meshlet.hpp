@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lve_culling.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// A cluster of consecutive triangles in a model's index buffer, small enough to be culled as a
+// unit. Bounds are in model space.
+struct LveMeshlet {
+  static constexpr uint32_t MAX_VERTICES = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  glm::vec3 center;
+  float radius;
+  glm::vec3 coneApex;
+  float coneCutoff;  // sine of the normal cone half angle, > 1 when the cone cannot be culled
+  glm::vec3 coneAxis;
+  uint32_t firstIndex;
+  uint32_t triangleCount;
+  uint32_t vertexCount;
+
+  bool isVisible(const Frustum &frustum, const glm::vec3 &viewPosition) const {
+    return frustum.intersectsSphere(center, radius) &&
+           !isConeBackfacing(coneApex, coneAxis, coneCutoff, viewPosition);
+  }
+
+  // Splits the triangle list into runs of at most MAX_VERTICES unique vertices and MAX_TRIANGLES
+  // triangles without reordering it, so a cache-optimized order keeps clusters compact.
+  // firstIndex is relative to indices
+  static std::vector<LveMeshlet> build(
+      const uint32_t *indices, size_t indexCount, const float *positions, size_t positionStride, size_t vertexCount);
+};
+
+}  // namespace lve
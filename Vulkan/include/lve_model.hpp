@@ -2,6 +2,11 @@
 
 #include "lve_device.hpp"
 #include "lve_buffer.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include "lve_meshlet.hpp"
+#include "lve_upload_context.hpp"
+#include "lve_vertex_quantizer.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -10,9 +15,47 @@
 
 // std
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace lve {
+
+enum class VertexFormat {
+    Float,    // LveModel::Vertex, 44 bytes
+    Compact,  // LveCompactVertex, 20 bytes, needs the compact vertex shader
+};
+
+// Vertex buffers of a model: every attribute interleaved, or the positions alone for depth-only
+// passes, which then fetch 12 of 44 bytes per float vertex and 8 of 20 per compact one. Only
+// models imported with ModelImportOptions::positionStream have the second one
+enum class VertexStream {
+    Interleaved,
+    Position,
+};
+
+struct ModelImportOptions {
+    bool useMeshCache = true;
+    bool useNativeObjParser = true;  // false selects tinyobj, kept for comparison
+    float weldEpsilon = 0.f;         // > 0 merges vertices whose components snap to the same grid cell
+    bool optimizeMesh = true;        // vertex cache, overdraw and vertex fetch reordering
+    bool generateLods = true;        // quadric-simplified index ranges sharing the vertex buffer
+    bool generateMeshlets = true;    // cullable clusters over the full-detail triangles
+    VertexFormat vertexFormat = VertexFormat::Float;  // GPU layout only, the builder keeps floats
+    bool positionStream = false;     // upload a position-only copy of the vertices for the depth prepass
+};
+
+struct ModelImportStats {
+    size_t sourceBytes = 0;
+    double seconds = 0.0;
+    bool fromCache = false;
+    bool optimized = false;
+    VertexCacheStats cacheBefore{};  // only filled in when optimized
+    VertexCacheStats cacheAfter{};
+    LveVertexQuantizer::Error quantizationError{};  // only filled in for VertexFormat::Compact
+
+    double bytesPerSecond() const { return seconds > 0.0 ? sourceBytes / seconds : 0.0; }
+};
+
 class LveModel {
 public:
     struct Vertex {
@@ -21,47 +64,186 @@ public:
         glm::vec3 normal{};
         glm::vec2 uv{};
 
-        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(
+            VertexFormat format = VertexFormat::Float, VertexStream stream = VertexStream::Interleaved);
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(
+            VertexFormat format = VertexFormat::Float, VertexStream stream = VertexStream::Interleaved);
 
         bool operator==(const Vertex &other) const {
             return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
         }
     };
 
+    // Range of the shared index buffer; error is the largest deviation from the full-detail
+    // surface in model units, 0 for level 0
+    struct LodLevel {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error;
+    };
+
+    static constexpr uint32_t MAX_LOD_COUNT = 6;
+
+    // Range of the index buffer whose indices are stored relative to vertexOffset. A mesh with more
+    // than 65536 vertices still gets 16-bit indices if it splits into at most MAX_INDEX_SEGMENTS
+    // ranges that each address no more than 65536 vertices
+    struct IndexSegment {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+    };
+
+    static constexpr uint32_t MAX_INDEX_SEGMENTS = 16;
+
     struct Builder {
         std::vector<Vertex> vertices{};
         std::vector<uint32_t> indices{};
+        std::vector<LodLevel> lods{};  // empty means a single level covering all indices
+        std::vector<LveMeshlet> meshlets{};  // cover LOD 0 only
+        VertexFormat vertexFormat = VertexFormat::Float;
+        bool positionStream = false;
+        ModelImportStats importStats{};
+
+        void loadModel(const std::string &filepath, const ModelImportOptions &options = ModelImportOptions{});
+
+        // Reorders triangles and vertices for the post-transform cache, overdraw and vertex fetch.
+        // Must run before generateLods
+        void optimize();
 
-        void loadModel(const std::string &filepath);
+        // Bounds for VertexFormat::Compact quantization
+        LveVertexQuantizer createQuantizer() const;
+
+        // Round-trips every vertex through the compact encoding and returns the largest errors
+        LveVertexQuantizer::Error measureQuantizationError() const;
+
+        // Splits the LOD 0 triangles into meshlets without reordering them
+        void buildMeshlets();
+
+        // Appends successively halved versions of the indices as extra LOD ranges
+        void generateLods();
+
+    private:
+        void loadObjNative(const std::string &filepath, const ModelImportOptions &options);
+        void loadObjTinyObj(const std::string &filepath, const ModelImportOptions &options);
     };
 
+    // Uploads through the device's upload context and waits for the copies to finish
     LveModel(LveDevice &device, const LveModel::Builder &builder);
+    // Only queues the uploads; the model may be drawn once the token of the next
+    // uploadContext.flush() has completed
+    LveModel(LveDevice &device, const LveModel::Builder &builder, LveUploadContext &uploadContext);
     ~LveModel();
 
     LveModel(const LveModel &) = delete;
     LveModel &operator=(const LveModel &) = delete;
 
-    static std::unique_ptr<LveModel> createModelFromFile(LveDevice &device, const std::string &filepath);
-
-    void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    // Geometry pool ranges a model built from builder allocates, in allocation order, so loaders
+    // can check the device memory they need before uploading
+    static std::vector<LveGeometryPool::Request> getGeometryRequests(const Builder &builder);
+
+    static std::unique_ptr<LveModel> createModelFromFile(
+        LveDevice &device, const std::string &filepath, const ModelImportOptions &options = ModelImportOptions{});
+
+    // Unique per model created, for sort keys
+    uint32_t getId() const { return id; }
+
+    // Binds the geometry pool buffers holding this model; models sharing them need not rebind. Draws
+    // must then use the same stream, whose vertices live at a different pool offset
+    void bind(VkCommandBuffer commandBuffer, VertexStream stream = VertexStream::Interleaved);
+    VkBuffer getVertexBuffer(VertexStream stream = VertexStream::Interleaved) const;
+    VkBuffer getIndexBuffer() const;
+    void draw(
+        VkCommandBuffer commandBuffer,
+        uint32_t lod = 0,
+        uint32_t instanceCount = 1,
+        uint32_t firstInstance = 0,
+        VertexStream stream = VertexStream::Interleaved);
+    // Draws indices [firstIndex, firstIndex + indexCount), split at index segment boundaries
+    void drawIndexedRange(
+        VkCommandBuffer commandBuffer,
+        uint32_t firstIndex,
+        uint32_t indexCount,
+        uint32_t instanceCount = 1,
+        uint32_t firstInstance = 0,
+        VertexStream stream = VertexStream::Interleaved);
+    // Appends the indexed draws covering a LOD, one per index segment, with their geometry pool
+    // offsets resolved; they go stale once the pool's generation changes
+    void getIndirectCommands(
+        uint32_t lod,
+        std::vector<VkDrawIndexedIndirectCommand> &commands,
+        VertexStream stream = VertexStream::Interleaved) const;
+    bool isIndexed() const { return hasIndexBuffer; }
+
+    uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+    float getLodError(uint32_t lod) const { return lods[lod].error; }
+
+    // Picks the coarsest level whose error, scaled to pixels, stays within maxPixelError
+    uint32_t selectLod(float pixelsPerUnit, float maxPixelError) const;
+
+    // Draws the LOD 0 meshlets that pass Frustum and normal cone culling, merging adjacent visible
+    // meshlets into one draw. frustum and viewPosition are in model space. Returns the number of
+    // meshlets drawn
+    uint32_t drawMeshlets(
+        VkCommandBuffer commandBuffer,
+        const Frustum &frustum,
+        const glm::vec3 &viewPosition,
+        VertexStream stream = VertexStream::Interleaved);
+    bool hasMeshlets() const { return !meshlets.empty(); }
+
+    VertexFormat getVertexFormat() const { return vertexFormat; }
+    // Without it, depth-only passes have nothing to read and renderers shade the model without a prepass
+    bool hasPositionStream() const { return positionRange != LveGeometryPool::INVALID_RANGE; }
+    // Identity for float vertices; maps compact [0, 1] positions back to model space otherwise
+    const glm::mat4 &getDequantizationMatrix() const { return dequantizationMatrix; }
+
+    VkIndexType getIndexType() const { return indexType; }
+    // Index buffer bytes saved by 16-bit indices compared to 32-bit ones
+    VkDeviceSize getIndexBytesSaved() const;
+
+    // Geometry pool memory held by the vertices and indices
+    VkDeviceSize getMemorySize() const;
+
+    const glm::vec3 &getBoundingCenter() const { return boundingCenter; }
+    float getBoundingRadius() const { return boundingRadius; }
+    const glm::vec3 &getBoundingBoxMin() const { return boundingBoxMin; }
+    const glm::vec3 &getBoundingBoxMax() const { return boundingBoxMax; }
 
 private:
-    void createVertexBuffers(const std::vector<Vertex> &vertices);
-    void createIndexBuffers(const std::vector<uint32_t> &indices);
+    void createVertexBuffers(
+        const LveModel::Builder &builder,
+        LveUploadContext &uploadContext);
+    void createIndexBuffers(
+        const std::vector<uint32_t> &indices,
+        uint32_t vertexCount,
+        LveUploadContext &uploadContext);
+    void initializeFromBuilder(const LveModel::Builder &builder);
+    void computeBoundingVolumes(const std::vector<Vertex> &vertices);
+    LveGeometryPool::RangeId getVertexRange(VertexStream stream) const;
 
     LveDevice &lveDevice;
+    uint32_t id;
 
     //VkBuffer vertexBuffer;
     //VkDeviceMemory vertexBufferMemory;
-    std::unique_ptr<LveBuffer> vertexBuffer;
+    LveGeometryPool::RangeId vertexRange = LveGeometryPool::INVALID_RANGE;
+    LveGeometryPool::RangeId positionRange = LveGeometryPool::INVALID_RANGE;
     uint32_t vertexCount;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    glm::mat4 dequantizationMatrix{1.f};
 
     bool hasIndexBuffer = false;
     //VkBuffer indexBuffer;
     //VkDeviceMemory indexBufferMemory;
-    std::unique_ptr<LveBuffer> indexBuffer;
+    LveGeometryPool::RangeId indexRange = LveGeometryPool::INVALID_RANGE;
     uint32_t indexCount;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::vector<IndexSegment> indexSegments;
+
+    std::vector<LodLevel> lods;
+    std::vector<LveMeshlet> meshlets;
+    glm::vec3 boundingCenter{};
+    float boundingRadius = 0.f;
+    glm::vec3 boundingBoxMin{};
+    glm::vec3 boundingBoxMax{};
 };
 }  // namespace lve
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Shared state of a model requested from LveModelLoader. Safe to poll from any thread.
+class LveModelHandle {
+ public:
+  enum class State { Loading, Resident, Failed };
+
+  explicit LveModelHandle(const std::string &filepath) : filepath{filepath} {}
+
+  LveModelHandle(const LveModelHandle &) = delete;
+  LveModelHandle &operator=(const LveModelHandle &) = delete;
+
+  State getState() const { return state.load(std::memory_order_acquire); }
+  bool isResident() const { return getState() == State::Resident; }
+  bool hasFailed() const { return getState() == State::Failed; }
+
+  // null until the model is resident
+  std::shared_ptr<LveModel> get() const { return isResident() ? model : nullptr; }
+
+  const std::string &getFilepath() const { return filepath; }
+  const std::string &getError() const { return error; }
+
+ private:
+  friend class LveModelLoader;
+  friend class LveModelRegistry;
+
+  std::string filepath;
+  std::atomic<State> state{State::Loading};
+  std::shared_ptr<LveModel> model{};
+  std::string error{};
+  std::chrono::steady_clock::time_point requestTime{std::chrono::steady_clock::now()};
+};
+
+// Loads models in the background. Files are imported on a small worker pool (the OBJ parser
+// itself still fans out over the shared pool), and update() queues everything parsed since the
+// previous call on the device's upload context and submits it as one batch, so the render thread
+// never waits on the GPU for a load.
+class LveModelLoader {
+ public:
+  static constexpr VkDeviceSize DEFAULT_UPLOAD_BUDGET = 64 * 1024 * 1024;
+
+  explicit LveModelLoader(LveDevice &device, uint32_t threadCount = 2);
+  ~LveModelLoader();
+
+  LveModelLoader(const LveModelLoader &) = delete;
+  LveModelLoader &operator=(const LveModelLoader &) = delete;
+
+  std::shared_ptr<LveModelHandle> load(
+      const std::string &filepath, const ModelImportOptions &options = ModelImportOptions{});
+
+  // Call once per frame from the thread that submits to the graphics queue. Marks the models of
+  // completed uploads resident and starts uploads for newly parsed ones
+  void update();
+
+  // Blocks until every requested model is resident or has failed
+  void waitIdle();
+
+  // Bytes of vertex and index data started per update(); at least one model is always uploaded
+  void setUploadBudget(VkDeviceSize bytes) { uploadBudget = bytes; }
+
+  uint32_t getPendingCount();
+  LveDevice &getDevice() { return lveDevice; }
+
+  // Bytes of parsed models held back last update() because uploading them would exceed the
+  // device local soft budget; LveModelRegistry evicts cached models to make room
+  VkDeviceSize getDeferredBytes() const { return deferredBytes; }
+  uint64_t getBudgetDeferralCount() const { return budgetDeferralCount; }
+
+ private:
+  struct ParsedModel {
+    std::shared_ptr<LveModelHandle> handle;
+    std::unique_ptr<LveModel::Builder> builder;
+    std::string error;
+    // what uploading the model allocates from the geometry pool, worked out on the worker
+    std::vector<LveGeometryPool::Request> geometry;
+    VkDeviceSize bytes = 0;
+  };
+
+  struct UploadBatch {
+    LveUploadContext::Token uploadToken;
+    std::vector<std::shared_ptr<LveModelHandle>> handles;
+    std::vector<std::shared_ptr<LveModel>> models;
+  };
+
+  void submitUploads(bool enforceMemoryBudget);
+  void retireUploads(bool wait);
+  // Whether placing the requests in the geometry pool keeps device local memory under the soft budget
+  bool fitsMemoryBudget(const std::vector<LveGeometryPool::Request> &requests);
+
+  LveDevice &lveDevice;
+
+  std::mutex mutex;
+  std::condition_variable parsedCondition;
+  std::deque<ParsedModel> parsedModels;
+  uint32_t parsingCount = 0;
+
+  std::vector<UploadBatch> uploadsInFlight;
+  VkDeviceSize uploadBudget = DEFAULT_UPLOAD_BUDGET;
+  VkDeviceSize deferredBytes = 0;
+  uint64_t budgetDeferralCount = 0;
+
+  // declared last so no worker is still running when the members above are destroyed
+  LveThreadPool workers;
+};
+
+}  // namespace lve
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "lve_model_loader.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Interns models by canonical file path, geometry-affecting import options and GPU layout, so
+// every object using the same mesh shares one set of GPU buffers. Entries nobody holds any more are
+// kept as a cache and evicted least recently used first once resident models exceed the memory
+// budget, or while the loader holds models back because the device is near its memory budget.
+class LveModelRegistry {
+ public:
+  static constexpr VkDeviceSize DEFAULT_MEMORY_BUDGET = 512ull * 1024 * 1024;
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint32_t entryCount = 0;
+    VkDeviceSize residentBytes = 0;
+    // Index buffer bytes resident models save by using 16-bit indices
+    VkDeviceSize indexBytesSaved = 0;
+  };
+
+  explicit LveModelRegistry(LveModelLoader &loader, VkDeviceSize memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+  LveModelRegistry(const LveModelRegistry &) = delete;
+  LveModelRegistry &operator=(const LveModelRegistry &) = delete;
+
+  std::shared_ptr<LveModelHandle> acquire(
+      const std::string &filepath, const ModelImportOptions &options = ModelImportOptions{});
+
+  // Call once per frame: evicts unreferenced entries while over budget. Evicted models free their
+  // geometry through the device's deletion queue, so frames in flight can still draw them
+  void update();
+
+  void setMemoryBudget(VkDeviceSize bytes) { memoryBudget = bytes; }
+  const Stats &getStats() const { return stats; }
+
+ private:
+  struct Entry {
+    std::shared_ptr<LveModelHandle> handle;
+    uint64_t lastUsedFrame;
+  };
+
+  static std::string makeKey(const std::string &filepath, const ModelImportOptions &options);
+  static bool isReferenced(const Entry &entry);
+
+  LveModelLoader &loader;
+  VkDeviceSize memoryBudget;
+
+  std::unordered_map<std::string, Entry> entries;
+  uint64_t frame = 0;
+  Stats stats{};
+};
+
+}  // namespace lve
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Parallel Wavefront OBJ reader. The file is memory-mapped, split into line-aligned chunks and
+// every chunk is parsed on the thread pool; the per-chunk results are then stitched together with
+// prefix sums so relative (negative) indices resolve exactly as in a sequential parse.
+//
+// Only geometry is read (v, vt, vn, f). Quads are split along the shorter diagonal and larger
+// polygons are fan-triangulated. Vertex colors follow the tinyobj convention of "v x y z r g b"
+// and default to white.
+class LveObjParser {
+ public:
+  struct Index {
+    int32_t position;  // -1 when absent
+    int32_t texcoord;
+    int32_t normal;
+  };
+
+  struct Result {
+    std::vector<float> positions{};  // xyz
+    std::vector<float> colors{};     // rgb, one per position
+    std::vector<float> normals{};    // xyz
+    std::vector<float> texcoords{};  // uv
+    std::vector<Index> indices{};    // three per triangle
+  };
+
+  struct Stats {
+    size_t bytes = 0;
+    uint32_t chunkCount = 0;
+    double seconds = 0.0;
+
+    double bytesPerSecond() const { return seconds > 0.0 ? bytes / seconds : 0.0; }
+  };
+
+  static Result parse(
+      const std::string &filepath, LveThreadPool &pool = LveThreadPool::shared(), Stats *stats = nullptr);
+};
+
+}  // namespace lve
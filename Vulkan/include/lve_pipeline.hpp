@@ -13,6 +13,8 @@ struct PipelineConfigInfo {
   PipelineConfigInfo(const PipelineConfigInfo&) = delete;
   PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
   VkPipelineViewportStateCreateInfo viewportInfo;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
   VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -29,7 +31,10 @@ struct PipelineConfigInfo {
 
 class LvePipeline {
  public:
+  // An empty fragFilepath creates a pipeline without a fragment stage, for depth-only passes
   LvePipeline(LveDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+  // Compute pipeline; bind() then binds to VK_PIPELINE_BIND_POINT_COMPUTE
+  LvePipeline(LveDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
   ~LvePipeline();
 
   LvePipeline(const LvePipeline&) = delete;
@@ -38,6 +43,11 @@ class LvePipeline {
   void bind(VkCommandBuffer commandBuffer);
 
   static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+  // Adjust a default configuration for a depth prepass, which writes depth but no color, and for
+  // the shading pass after it, which only keeps fragments at exactly the stored depth. Both passes
+  // must compute gl_Position identically, so their vertex shaders declare it invariant
+  static void depthOnlyPipelineConfigInfo(PipelineConfigInfo& configInfo);
+  static void depthEqualPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
  private:
   static std::vector<char> readFile(const std::string& filepath);
@@ -47,11 +57,15 @@ class LvePipeline {
       const std::string& fragFilepath,
       const PipelineConfigInfo& configInfo);
 
+  void createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
   void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
   LveDevice& lveDevice;
-  VkPipeline graphicsPipeline;
-  VkShaderModule vertShaderModule;
-  VkShaderModule fragShaderModule;
+  VkPipeline pipeline;
+  VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+  VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+  VkShaderModule compShaderModule = VK_NULL_HANDLE;
 };
 }  // namespace lve
@@ -0,0 +1,47 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Draws reduced to 64-bit sort keys plus a caller-defined item index, ordered once per frame with
+// an LSD radix sort. Keys put state changes first so equal state ends up adjacent:
+//
+//   63..60 pipeline    59..56 depth band    55..36 model    35..32 LOD
+//   31..24 material    23..0  depth
+//
+// The coarse depth band sits above the model so opaque draws go roughly front to back across
+// models for early depth rejection, while draws of one model within a band still sort together
+// and can be instanced; the fine depth orders them front to back inside that run.
+class LveRenderQueue {
+ public:
+  struct Entry {
+    uint64_t key;
+    uint32_t item;
+  };
+
+  // distance is from the camera and must be non-negative; ids wider than their field wrap, which
+  // costs batching but not correctness as long as submission compares the actual state
+  static uint64_t makeKey(uint32_t pipeline, float distance, uint32_t modelId, uint32_t lod, uint32_t material);
+
+  void clear() { entries.clear(); }
+  void reserve(size_t capacity) { entries.reserve(capacity); }
+  void push(uint64_t key, uint32_t item) { entries.push_back({key, item}); }
+
+  // Stable, so equal keys keep their push order. Byte positions that are the same in every key are
+  // skipped
+  void sort();
+
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  const Entry &operator[](size_t index) const { return entries[index]; }
+
+ private:
+  std::vector<Entry> entries;
+  std::vector<Entry> scratch;
+};
+
+}  // namespace lve
@@ -20,6 +20,10 @@ public:
 
     VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
     float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+    VkExtent2D getSwapChainExtent() const { return lveSwapChain->getSwapChainExtent(); }
+    VkImage getDepthImage() const { return lveSwapChain->getDepthImage(); }
+    VkImageView getDepthImageView() const { return lveSwapChain->getDepthImageView(); }
+    VkFormat getDepthFormat() const { return lveSwapChain->getDepthFormat(); }
     bool isFrameInProgress() const { return isFrameStarted; }
 
     VkCommandBuffer getCurrentCommandBuffer() const {
@@ -27,14 +31,27 @@ public:
         return commandBuffers[currentFrameIndex];
     }
 
+    // Framebuffer of the swap chain image the current frame renders to
+    VkFramebuffer getCurrentFramebuffer() const {
+        assert(isFrameStarted && "Cannot get framebuffer when frame not in progress");
+        return lveSwapChain->getFrameBuffer(static_cast<int>(currentImageIndex));
+    }
+
     int getFrameIndex() const {
         assert(isFrameStarted && "Cannot get frame index when frame not in progress");
         return currentFrameIndex;
     }
 
+    // Keeps the depth buffer after the render pass so it can be sampled; recreates the swap chain
+    // when the setting changes. Render passes stay compatible, so existing pipelines remain valid
+    void setDepthSampled(bool sampled);
+
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass may only execute secondary
+    // command buffers, which set their own viewport and scissor
+    void beginSwapChainRenderPass(
+        VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
 private:
@@ -50,5 +67,6 @@ private:
     uint32_t currentImageIndex;
     int currentFrameIndex{0};
     bool isFrameStarted{false};
+    bool depthSampled{false};
 };
 }  // namespace lve
@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// Space bookkeeping of a staging ring filled by batches that are released in submission order.
+// Allocations go to the batch being recorded until closeBatch() hands its byte count to the
+// caller, who releases it once the batch has executed. Keeping the open batch's count here
+// rather than in the caller's batch object means swapping that object never loses bytes.
+class LveStagingRing {
+ public:
+  explicit LveStagingRing(uint64_t size = 0);
+
+  // Places size bytes, rounded up to alignment (a power of two), at the head of the ring; an
+  // allocation never straddles the end, the skipped tail is charged to the open batch instead.
+  // Returns false when the ring is too full and older batches have to be released first
+  bool allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+
+  // Ends the open batch and returns the ring bytes it holds
+  uint64_t closeBatch();
+  // Returns the bytes of the oldest closed batch
+  void release(uint64_t bytes);
+
+  uint64_t getSize() const { return size; }
+  // Bytes held by closed batches that are not released yet and by the open batch
+  uint64_t getUsedBytes() const { return usedBytes; }
+  uint64_t getOpenBatchBytes() const { return openBatchBytes; }
+
+ private:
+  uint64_t size;
+  uint64_t head = 0;
+  uint64_t usedBytes = 0;
+  uint64_t openBatchBytes = 0;
+};
+
+}  // namespace lve
@@ -16,8 +16,11 @@ class LveSwapChain {
  public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
+  // With sampledDepth the depth buffer is stored at the end of the render pass and can be read by
+  // shaders afterwards, instead of living only in tile memory
+  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, bool sampledDepth = false);
+  LveSwapChain(
+      LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous, bool sampledDepth = false);
 
   ~LveSwapChain();
 
@@ -27,6 +30,10 @@ class LveSwapChain {
   VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
   VkRenderPass getRenderPass() { return renderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  VkImage getDepthImage() { return depthImage; }
+  VkImageView getDepthImageView() { return depthImageView; }
+  VkFormat getDepthFormat() { return swapChainDepthFormat; }
+  bool isDepthSampled() const { return sampledDepth; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -36,7 +43,11 @@ class LveSwapChain {
   float extentAspectRatio() {
     return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
   }
+  // Needs VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT with sampledDepth. A format that can be sampled is
+  // preferred either way, so turning sampledDepth on keeps the render pass compatible
   VkFormat findDepthFormat();
+  // Whether a depth format can be sampled, which sampledDepth requires
+  static bool supportsSampledDepth(LveDevice &device);
 
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
@@ -67,14 +78,17 @@ class LveSwapChain {
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
-  std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
-  std::vector<VkImageView> depthImageViews;
+  // one depth buffer shared by every framebuffer, transient unless sampledDepth; the render pass
+  // dependency orders each frame's depth writes after the previous frame's
+  VkImage depthImage;
+  LveAllocation depthImageAllocation;
+  VkImageView depthImageView;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
   LveDevice &device;
   VkExtent2D windowExtent;
+  bool sampledDepth;
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<LveSwapChain> oldSwapChain;
@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lve {
+
+class LveThreadPool {
+ public:
+  explicit LveThreadPool(uint32_t threadCount = defaultThreadCount());
+  ~LveThreadPool();
+
+  LveThreadPool(const LveThreadPool &) = delete;
+  LveThreadPool &operator=(const LveThreadPool &) = delete;
+
+  // shared pool for short data-parallel jobs (parsing, mesh processing)
+  static LveThreadPool &shared();
+  static uint32_t defaultThreadCount();
+
+  template <typename F>
+  auto submit(F &&task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+    using R = std::invoke_result_t<std::decay_t<F>>;
+    auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    std::future<R> future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+  }
+
+  // Runs fn(i) for every i in [0, count) and blocks until all calls have returned. The calling
+  // thread takes part in the work, so this is safe to call from inside another pool's task.
+  void parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn);
+
+  uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+ private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+};
+
+}  // namespace lve
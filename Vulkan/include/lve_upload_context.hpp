@@ -0,0 +1,123 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_staging_ring.hpp"
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace lve {
+
+// Streams host data to device local buffers and images through a persistently mapped staging
+// ring. Copies accumulate in one command buffer until flush() submits them with a fence and
+// returns a token that callers poll or wait on, so uploads never idle the whole queue. When the
+// ring runs full the pending copies are submitted and the oldest batch is waited for.
+//
+// On devices with a dedicated transfer queue family the copies run there, concurrently with
+// rendering. Each batch ends by releasing its resources to the graphics family and signals a
+// semaphore; once the copies are seen complete, a small graphics submission waits on that
+// semaphore and acquires the resources. Tokens complete only after the acquire, so the graphics
+// queue never stalls behind an unfinished upload.
+//
+// Not thread safe; use it from the thread that submits to the graphics queue.
+class LveUploadContext {
+ public:
+  using Token = uint64_t;
+
+  static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+  struct Stats {
+    uint64_t bytesUploaded = 0;
+    uint64_t copyCount = 0;
+    uint64_t submitCount = 0;
+    // copies that had to wait for the GPU to release staging space
+    uint64_t stallCount = 0;
+    // wall clock time during which at least one submitted batch was still executing
+    double busySeconds = 0.0;
+
+    double megabytesPerSecond() const {
+      return busySeconds > 0.0 ? bytesUploaded / (1024.0 * 1024.0) / busySeconds : 0.0;
+    }
+  };
+
+  explicit LveUploadContext(LveDevice &device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+  ~LveUploadContext();
+
+  LveUploadContext(const LveUploadContext &) = delete;
+  LveUploadContext &operator=(const LveUploadContext &) = delete;
+
+  // Data is copied into the ring immediately, so it may be released as soon as the call returns.
+  // Buffers created with shareWithTransferQueue are handed over by the semaphore alone and need
+  // concurrentSharing set
+  void uploadBuffer(
+      VkBuffer dstBuffer,
+      VkDeviceSize dstOffset,
+      const void *data,
+      VkDeviceSize size,
+      bool concurrentSharing = false);
+  // The image must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL when the copies execute and is
+  // left in that layout
+  void uploadImage(
+      VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void *data, VkDeviceSize size);
+
+  // Submits everything recorded so far; later draws on the graphics queue see the written data
+  Token flush();
+  bool isComplete(Token token);
+  void wait(Token token);
+  void waitIdle();
+
+  const Stats &getStats() const { return stats; }
+
+ private:
+  struct Batch {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    // graphics side of the ownership transfer, only used with a dedicated transfer queue
+    VkSemaphore transferComplete = VK_NULL_HANDLE;
+    VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+    VkFence acquireFence = VK_NULL_HANDLE;
+    bool acquireSubmitted = false;
+    std::vector<VkBuffer> buffers;
+    std::vector<VkImage> images;
+
+    Token token = 0;
+    // ring bytes consumed, including the skipped tail when the batch wrapped around; set on submit
+    VkDeviceSize ringBytes = 0;
+    uint32_t copyCount = 0;
+  };
+
+  VkDeviceSize allocateStaging(VkDeviceSize size);
+  VkCommandBuffer getRecordingCommandBuffer();
+  void recordOwnershipTransfer(VkCommandBuffer commandBuffer, const Batch &batch, bool release);
+  void submitAcquire(Batch &batch);
+  bool isBatchComplete(const Batch &batch);
+  void retireCompleted();
+  void waitOldest();
+
+  LveDevice &lveDevice;
+  bool dedicatedTransfer;
+  uint32_t graphicsFamily;
+  uint32_t transferFamily;
+  VkCommandPool commandPool;
+  VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+
+  VkBuffer stagingBuffer;
+  LveAllocation stagingAllocation;
+  char *stagingData;
+  VkDeviceSize stagingSize;
+  LveStagingRing ring;
+
+  Batch recording{};
+  std::deque<Batch> inFlight;
+  std::vector<Batch> freeBatches;
+  Token nextToken = 1;
+  Token completedToken = 0;
+
+  Stats stats{};
+  std::chrono::steady_clock::time_point busyStart;
+};
+
+}  // namespace lve
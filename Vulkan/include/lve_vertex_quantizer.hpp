@@ -0,0 +1,59 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+
+namespace lve {
+
+// 20-byte vertex: positions as 16-bit unorm within the model bounds, colors as 8-bit unorm,
+// octahedral normals as 16-bit snorm and uvs as half floats
+struct LveCompactVertex {
+  uint16_t position[4];  // w unused, keeps the attribute 8-byte aligned
+  uint8_t color[4];      // a unused
+  int16_t normal[2];
+  uint16_t uv[2];
+};
+
+static_assert(sizeof(LveCompactVertex) == 20, "LveCompactVertex must stay tightly packed");
+
+// Encodes vertices into LveCompactVertex for one set of model bounds. decode() reproduces what
+// the vertex shader sees after the fixed-function format conversion and the dequantization matrix,
+// so CPU and GPU results can be compared directly.
+class LveVertexQuantizer {
+ public:
+  struct Error {
+    float position = 0.f;  // model units
+    float normal = 0.f;    // radians
+    float uv = 0.f;
+    float color = 0.f;
+  };
+
+  LveVertexQuantizer(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+
+  LveCompactVertex encode(
+      const glm::vec3 &position, const glm::vec3 &color, const glm::vec3 &normal, const glm::vec2 &uv) const;
+  void decode(
+      const LveCompactVertex &vertex, glm::vec3 &position, glm::vec3 &color, glm::vec3 &normal, glm::vec2 &uv) const;
+
+  // Maps the [0, 1] unorm positions back to model space; applied on the model matrix
+  glm::mat4 getDequantizationMatrix() const;
+
+  // Largest errors the encoding may introduce for these bounds and uvs within [-uvRange, uvRange]
+  Error getErrorBound(float uvRange = 1.f) const;
+
+  static glm::vec2 encodeOctahedral(const glm::vec3 &normal);
+  static glm::vec3 decodeOctahedral(const glm::vec2 &encoded);
+  static uint16_t floatToHalf(float value);
+  static float halfToFloat(uint16_t value);
+
+ private:
+  glm::vec3 boundsMin;
+  glm::vec3 extent;
+};
+
+}  // namespace lve
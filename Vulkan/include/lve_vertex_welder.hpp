@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lve_model.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Flat open-addressing table used to weld identical vertices during import.
+//
+// Each weld() hashes the raw 44 bytes of the vertex once and walks a single linear probe
+// sequence; slots hold the hash and the index into the output vertex array, so no per-vertex
+// allocations are made. With a non-zero epsilon every component is snapped to a grid of that
+// size before hashing and comparing, and the first vertex seen in a cell is kept.
+class LveVertexWelder {
+ public:
+  LveVertexWelder(std::vector<LveModel::Vertex> &vertices, size_t expectedInsertions, float epsilon = 0.f);
+
+  LveVertexWelder(const LveVertexWelder &) = delete;
+  LveVertexWelder &operator=(const LveVertexWelder &) = delete;
+
+  // Returns the index of an equal vertex already in the output array, appending it if needed
+  uint32_t weld(const LveModel::Vertex &vertex);
+
+ private:
+  static constexpr uint32_t KEY_WORDS = sizeof(LveModel::Vertex) / sizeof(uint32_t);
+  static constexpr uint32_t EMPTY = 0xffffffff;
+
+  struct Key {
+    uint32_t words[KEY_WORDS];
+  };
+
+  struct Slot {
+    uint32_t hash;
+    uint32_t index;
+  };
+
+  Key makeKey(const LveModel::Vertex &vertex) const;
+  static uint32_t hashKey(const Key &key);
+  void grow();
+
+  std::vector<LveModel::Vertex> &vertices;
+  std::vector<Slot> slots;
+  size_t mask;
+  float inverseEpsilon;
+};
+
+}  // namespace lve
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_command_recorder.hpp"
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_render_queue.hpp"
 
 
 // std
@@ -22,13 +24,108 @@ public:
 
     void renderGameObjects(FrameInfo &frameInfo, std::vector<LveGameObject> &gameObjects);
 
+    // Largest on-screen geometric error, in pixels, allowed when picking a model LOD
+    void setMaxLodPixelError(float pixels) { maxLodPixelError = pixels; }
+
+    // Draws only the meshlets of full-detail models that are inside the frustum and not back-facing.
+    // Applies to models used by a single object; shared models are drawn instanced instead. Off by
+    // default: the pipelines draw both faces, and open meshes like viking_room show their back faces
+    void setClusterCulling(bool enabled) { clusterCulling = enabled; }
+
+    // Records batches on the recorder's workers into secondary command buffers; the render pass
+    // must then begin with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. nullptr records inline
+    void setCommandRecorder(LveCommandRecorder *recorder) { commandRecorder = recorder; }
+
+    // Draws every batch depth-only from the position stream first, then shades with an EQUAL depth
+    // test, so each pixel runs the fragment shader once however many surfaces cover it
+    void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+    bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+    // Objects drawing the same model and LOD become one instanced draw. Turning this off draws every
+    // object on its own, which is only useful for measuring the CPU cost of recording many draws
+    void setInstancing(bool enabled) { instancing = enabled; }
+
+    // Objects skipped by the last renderGameObjects() call for lying outside the view frustum
+    uint32_t getCulledCount() const { return culledCount; }
+
+    // Counters of the last renderGameObjects() call; a batch is one model and LOD, drawn instanced
+    // or as culled meshlets, and skipped binds are those that would have repeated bound state. With
+    // the depth prepass they cover both passes
+    struct Stats {
+        uint32_t batchCount = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t pipelineBindsSkipped = 0;
+        uint32_t geometryBinds = 0;
+        uint32_t geometryBindsSkipped = 0;
+        // wall clock time spent recording the batches, on all workers together
+        float recordMilliseconds = 0.f;
+    };
+    const Stats &getStats() const { return stats; }
+
+    // Per-instance vertex data, written to the frame allocator; the frame allocator buffer needs
+    // VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+    struct InstanceData {
+        glm::mat4 modelMatrix;
+        glm::vec4 normalMatrix[3];  // mat3 columns
+        glm::vec4 color;
+    };
+    static constexpr uint32_t INSTANCE_BINDING = 1;
+    // Adds the InstanceData binding and its attributes at locations 4 to 11
+    static void addInstanceInputs(PipelineConfigInfo &configInfo);
+
 private:
+    struct DrawItem {
+        LveModel *model;
+        uint32_t lod;
+        uint32_t objectIndex;
+    };
+
+    struct Batch {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // the variants of one pass, by vertex format and instancing
+    struct PipelineSet {
+        std::unique_ptr<LvePipeline> plain;
+        std::unique_ptr<LvePipeline> compact;  // for models with VertexFormat::Compact, once one is drawn
+        std::unique_ptr<LvePipeline> instanced;
+        std::unique_ptr<LvePipeline> compactInstanced;
+
+        LvePipeline *select(bool compactVertices, bool instancedDraw) const;
+    };
+
+    // fewer batches than this per worker are not worth another secondary command buffer
+    static constexpr size_t MIN_BATCHES_PER_TASK = 32;
+
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void createPipeline(VkRenderPass renderPass);
+    // the variants of every pass for one vertex format
+    void createPipelines(VkRenderPass renderPass, VertexFormat format);
 
     LveDevice &lveDevice;
+    LveCommandRecorder *commandRecorder = nullptr;
 
-    std::unique_ptr<LvePipeline> lvePipeline;
+    PipelineSet shadedPipelines;
+    PipelineSet depthOnlyPipelines;   // the prepass, reading the position stream
+    PipelineSet depthEqualPipelines;  // shading after the prepass
     VkPipelineLayout pipelineLayout;
+
+    // reused every frame
+    std::vector<DrawItem> drawItems;
+    std::vector<DrawItem> sortedItems;
+    std::vector<Batch> batches;
+    std::vector<Stats> workerStats;
+    LveRenderQueue renderQueue;
+    std::vector<glm::mat4> modelMatrices;
+    LveCullList cullList;
+    std::vector<uint32_t> cullObjects;  // game object index of each cull list entry
+    std::vector<uint32_t> visibleEntries;
+    uint32_t culledCount = 0;
+    Stats stats{};
+
+    float maxLodPixelError = 1.f;
+    bool clusterCulling = false;
+    bool depthPrepass = false;
+    bool instancing = true;
 };
 }  // namespace lve
@@ -1,13 +1,90 @@
-
 #include "first_app.hpp"
 
 // std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+
+static void printUsage(const char *program) {
+  std::cerr << "usage: " << program
+            << " [--render-path auto|cpu|gpu] [--verify-culling] [--cubes count] [--frames count]\n"
+            << "       [--record-threads count] [--separate-draws] [--depth-prepass]\n"
+            << "  --render-path path      cull and draw on the CPU, on the GPU, or on the GPU when the\n"
+            << "                          device supports it (auto, the default); G switches at runtime\n"
+            << "  --verify-culling        draw on the GPU and compare its culling counts with a CPU\n"
+            << "                          frustum test\n"
+            << "  --cubes count           add a block of count cubes to the scene\n"
+            << "  --frames count          run count frames once every model is resident, print the\n"
+            << "                          average frame time and exit\n"
+            << "  --record-threads count  record the CPU path's draws on count workers\n"
+            << "  --separate-draws        draw every object of the CPU path on its own instead of\n"
+            << "                          instancing\n"
+            << "  --depth-prepass         upload position-only vertices and lay down depth before\n"
+            << "                          shading; P toggles it at runtime\n";
+}
+
+static bool parseOptions(int argc, char **argv, lve::FirstApp::Options &options) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--verify-culling") == 0) {
+      options.verifyCulling = true;
+      continue;
+    }
+    if (std::strcmp(argv[i], "--separate-draws") == 0) {
+      options.separateDraws = true;
+      continue;
+    }
+    if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+      options.depthPrepass = true;
+      continue;
+    }
+    if (std::strcmp(argv[i], "--render-path") == 0) {
+      if (++i == argc) {
+        return false;
+      }
+      if (std::strcmp(argv[i], "auto") == 0) {
+        options.renderPath = lve::FirstApp::RenderPath::Auto;
+      } else if (std::strcmp(argv[i], "cpu") == 0) {
+        options.renderPath = lve::FirstApp::RenderPath::Cpu;
+      } else if (std::strcmp(argv[i], "gpu") == 0) {
+        options.renderPath = lve::FirstApp::RenderPath::Gpu;
+      } else {
+        return false;
+      }
+      continue;
+    }
+
+    uint32_t *value = nullptr;
+    if (std::strcmp(argv[i], "--cubes") == 0) {
+      value = &options.cubeCount;
+    } else if (std::strcmp(argv[i], "--frames") == 0) {
+      value = &options.benchmarkFrames;
+    } else if (std::strcmp(argv[i], "--record-threads") == 0) {
+      value = &options.recordThreads;
+    } else {
+      return false;
+    }
+    if (++i == argc) {
+      return false;
+    }
+    try {
+      *value = static_cast<uint32_t>(std::stoul(argv[i]));
+    } catch (const std::exception &) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  lve::FirstApp::Options options{};
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
 
-int main() {
-  lve::FirstApp app{};
+  lve::FirstApp app{options};
 
   try {
     app.run();
@@ -17,4 +94,4 @@ int main() {
   }
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -3,5 +3,13 @@ C:\VulkanSDK\1.3.239.0\Bin\glslc.exe shader.frag -o bin\frag.spv
 
 C:\VulkanSDK\1.3.239.0\Bin\glslc.exe simple_shader.vert -o bin\simple_shader.vert.spv
 C:\VulkanSDK\1.3.239.0\Bin\glslc.exe simple_shader.frag -o bin\simple_shader.frag.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe -DLVE_COMPACT_VERTEX simple_shader.vert -o bin\simple_shader_compact.vert.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe -DLVE_INSTANCED simple_shader.vert -o bin\simple_shader_instanced.vert.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe -DLVE_COMPACT_VERTEX -DLVE_INSTANCED simple_shader.vert -o bin\simple_shader_compact_instanced.vert.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe depth_only.vert -o bin\depth_only.vert.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe -DLVE_INSTANCED depth_only.vert -o bin\depth_only_instanced.vert.spv
+
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe cull.comp -o bin\cull.comp.spv
+C:\VulkanSDK\1.3.239.0\Bin\glslc.exe depth_reduce.comp -o bin\depth_reduce.comp.spv
 
 pause
\ No newline at end of file
@@ -0,0 +1,34 @@
+#version 450
+
+// Depth prepass: positions only, transformed exactly like simple_shader.vert so the shading pass
+// can depth test with VK_COMPARE_OP_EQUAL. Compact positions arrive in the same unorm encoding and
+// are dequantized by the model matrix in both.
+// LVE_INSTANCED: the model matrix comes per instance instead of from the push constants
+layout(location = 0) in vec3 position;
+#ifdef LVE_INSTANCED
+layout(location = 4) in mat4 instanceModelMatrix;
+#endif
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionVeiwMatrix;
+	vec3 directionToLight;
+} ubo;
+
+#ifndef LVE_INSTANCED
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  vec3 color;
+} push;
+#endif
+
+invariant gl_Position;
+
+void main() {
+#ifdef LVE_INSTANCED
+  mat4 modelMatrix = instanceModelMatrix;
+#else
+  mat4 modelMatrix = push.modelMatrix;
+#endif
+  gl_Position = ubo.projectionVeiwMatrix * modelMatrix * vec4(position, 1.0);
+}
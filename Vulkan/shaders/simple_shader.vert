@@ -1,9 +1,24 @@
 #version 450
 
+// LVE_COMPACT_VERTEX: positions arrive as unorm [0, 1] within the model bounds (the bounds are
+// folded into modelMatrix) and normals as a 2-component octahedral encoding
+// LVE_INSTANCED: model matrix, normal matrix and color come per instance instead of from the
+// push constants
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
+#ifdef LVE_COMPACT_VERTEX
+layout(location = 2) in vec2 octNormal;
+#else
 layout(location = 2) in vec3 normal;
+#endif
 layout(location = 3) in vec2 uv;
+#ifdef LVE_INSTANCED
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in vec4 instanceNormalMatrix0;
+layout(location = 9) in vec4 instanceNormalMatrix1;
+layout(location = 10) in vec4 instanceNormalMatrix2;
+layout(location = 11) in vec4 instanceColor;
+#endif
 
 layout(location = 0) out vec3 fragColor;
 
@@ -18,14 +33,38 @@ layout(push_constant) uniform Push {
   vec3 color;
 } push;
 
+// matches depth_only.vert bit for bit, for shading after a depth prepass
+invariant gl_Position;
+
 const float AMBIENT = 0.1;
 
+#ifdef LVE_COMPACT_VERTEX
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+  return normalize(n);
+}
+#endif
+
 void main() {
-  gl_Position = ubo.projectionVeiwMatrix * push.modelMatrix * vec4(position, 1.0);
+#ifdef LVE_COMPACT_VERTEX
+  vec3 normal = decodeOctahedral(octNormal);
+#endif
+#ifdef LVE_INSTANCED
+  mat4 modelMatrix = instanceModelMatrix;
+  mat3 normalMatrix = mat3(instanceNormalMatrix0.xyz, instanceNormalMatrix1.xyz, instanceNormalMatrix2.xyz);
+  vec3 color = instanceColor.rgb;
+#else
+  mat4 modelMatrix = push.modelMatrix;
+  mat3 normalMatrix = mat3(push.normalMatrix);
+  vec3 color = push.color;
+#endif
+  gl_Position = ubo.projectionVeiwMatrix * modelMatrix * vec4(position, 1.0);
 
-  vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+  vec3 normalWorldSpace = normalize(normalMatrix * normal);
 
   float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
 
-  fragColor = lightIntensity * push.color; // color
+  fragColor = lightIntensity * color; // color
 }
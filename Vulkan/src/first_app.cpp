@@ -1,7 +1,9 @@
 #include "first_app.hpp"
 
+#include "gpu_driven_render_system.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "lve_camera.hpp"
+#include "lve_gpu_timer.hpp"
 #include "simple_render_system.hpp"
 
 // libs
@@ -14,11 +16,9 @@
 #include <array>
 #include <cassert>
 #include <chrono>
-#include <stdexcept>
-
-#ifdef _DEBUG
+#include <cmath>
 #include <iostream>
-#endif
+#include <stdexcept>
 
 glm::vec3 rgbToTheroOne(int r, int g, int b) {
     return glm::vec3{ r / 255.f, g / 255.f, b / 255.f };
@@ -26,15 +26,49 @@ glm::vec3 rgbToTheroOne(int r, int g, int b) {
 
 namespace lve {
 
+#ifdef _DEBUG
+static void printMemoryBudgets(LveAllocator& allocator) {
+    std::cout << "memory heaps" << (allocator.hasMemoryBudgetExtension() ? "" : " (estimated budgets)") << ":" << std::endl;
+    const auto heaps = allocator.getHeapBudgets();
+    for (size_t i = 0; i < heaps.size(); i++) {
+        const auto& heap = heaps[i];
+        std::cout << "  heap " << i << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " device local: " : " host: ")
+                  << heap.usage / (1024.0 * 1024.0) << " of " << heap.budget / (1024.0 * 1024.0) << " MB budget ("
+                  << heap.softBudget / (1024.0 * 1024.0) << " MB soft), ours " << heap.deviceMemoryBytes / (1024.0 * 1024.0)
+                  << " MB";
+        for (uint32_t category = 0; category < LVE_MEMORY_CATEGORY_COUNT; category++) {
+            if (heap.categoryBytes[category] > 0) {
+                std::cout << ", " << getMemoryCategoryName(static_cast<LveMemoryCategory>(category)) << " "
+                          << heap.categoryBytes[category] / (1024.0 * 1024.0) << " MB";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+#endif
+
+static void printGpuCulling(const GpuDrivenRenderSystem& renderSystem) {
+    std::cout << "gpu culling: " << renderSystem.getVisibleCount() << " of " << renderSystem.getObjectCount()
+              << " objects visible, " << renderSystem.getOccludedCount() << " occluded, "
+              << renderSystem.getDrawCount() << " draws" << std::endl;
+    if (renderSystem.getReferenceCheckCount() > 0) {
+        std::cout << "gpu culling check: " << renderSystem.getReferenceCount() << " objects in the frustum on the CPU, "
+                  << renderSystem.getReferenceMismatchCount() << " of " << renderSystem.getReferenceCheckCount()
+                  << " readbacks disagreed" << std::endl;
+    }
+}
+
 struct GlobalUbo {
     alignas(16) glm::mat4 projection{ 1.f };
     alignas(16) glm::vec3 lightDirection = glm::normalize(glm::vec3{ 1.f, -3.f, -1.f });
 };
 
-FirstApp::FirstApp() { 
+FirstApp::FirstApp() : FirstApp{Options{}} {}
+
+FirstApp::FirstApp(const Options &options) : options{options} {
     globalPool = LveDescriptorPool::Builder(lveDevice)
         .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
         .build();
     loadGameObjects(); 
 }
@@ -42,31 +76,59 @@ FirstApp::FirstApp() {
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
-    std::vector<std::unique_ptr<LveBuffer>> ubobuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < ubobuffers.size(); i++) {
-        ubobuffers[i] = std::make_unique<LveBuffer>(
-            lveDevice,
-            sizeof(GlobalUbo),
-            1,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT //  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
-        ubobuffers[i]->map();
-    }
+    // per-frame uniforms and instance data are bump allocated and addressed by dynamic offsets.
+    // Sized for ~100k instances; larger scenes grow it
+    LveFrameAllocator frameAllocator{
+        lveDevice,
+        16 * 1024 * 1024,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT };
 
     auto globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
-        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
         .build();
 
-    std::vector<VkDescriptorSet> globalDescriptorSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < globalDescriptorSets.size(); i++) {
-        auto bufferInfo = ubobuffers[i]->descriptorInfo();
+    // a set per frame in flight, so each can be pointed at a grown frame allocator buffer once its
+    // frame is no longer read by the GPU
+    std::array<VkDescriptorSet, LveSwapChain::MAX_FRAMES_IN_FLIGHT> globalDescriptorSets;
+    std::array<uint64_t, LveSwapChain::MAX_FRAMES_IN_FLIGHT> globalSetGenerations;
+    for (int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
         LveDescriptorWriter(*globalSetLayout, *globalPool)
             .writeBuffer(0, &bufferInfo)
             .build(globalDescriptorSets[i]);
+        globalSetGenerations[i] = frameAllocator.getGeneration();
     }
 
     SimpleRenderSystem simpleRenderSystem{lveDevice, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+    // records draws on several threads into secondary command buffers
+    LveCommandRecorder commandRecorder{
+        lveDevice, options.recordThreads > 0 ? options.recordThreads : LveThreadPool::defaultThreadCount() + 1};
+    simpleRenderSystem.setCommandRecorder(&commandRecorder);
+    simpleRenderSystem.setInstancing(!options.separateDraws);
+    simpleRenderSystem.setDepthPrepass(options.depthPrepass);
+    // culls and draws on the GPU when the device can generate its own draw counts; G switches
+    // between the two paths
+    std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem;
+    const bool occlusionCulling = LveSwapChain::supportsSampledDepth(lveDevice);
+    if (options.renderPath == RenderPath::Gpu || lveDevice.supportsDrawIndirectCount()) {
+        // occlusion culling reads back the depth buffer, which needs a depth format that can be sampled
+        lveRenderer.setDepthSampled(occlusionCulling);
+        gpuDrivenRenderSystem = std::make_unique<GpuDrivenRenderSystem>(
+            lveDevice, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout());
+        gpuDrivenRenderSystem->setOcclusionCulling(occlusionCulling);
+        gpuDrivenRenderSystem->setObjects(gameObjects);
+        gpuDrivenRenderSystem->setCpuReference(options.verifyCulling);
+        gpuDrivenRenderSystem->setDepthPrepass(options.depthPrepass);
+    } else if (options.verifyCulling) {
+        throw std::runtime_error("verifying GPU culling requires VK_KHR_draw_indirect_count!");
+    }
+    bool gpuDriven = gpuDrivenRenderSystem && (options.renderPath != RenderPath::Cpu || options.verifyCulling);
+    bool pathKeyDown = false;
+    // P toggles the depth prepass when models were imported for it; the render pass GPU time shows
+    // what it buys
+    bool depthPrepass = options.depthPrepass;
+    bool prepassKeyDown = false;
+    LveGpuTimer renderPassTimer{lveDevice};
 
     LveCamera camera{};
     float aspect = lveRenderer.getAspectRatio();
@@ -74,6 +136,14 @@ void FirstApp::run() {
     camera.transform.translation = { 0.f, -2.f, -15.f };
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    // benchmark frames are only counted once every model has streamed in
+    uint32_t benchmarkFrameCount = 0;
+    auto benchmarkStart = currentTime;
+    double benchmarkRecordMilliseconds = 0.0;
+    double benchmarkRenderPassMilliseconds = 0.0;
+#ifdef _DEBUG
+    auto lastMemoryReport = currentTime;
+#endif
 
     while (!lveWindow.shouldClose()) {
         // delta time 
@@ -82,53 +152,194 @@ void FirstApp::run() {
         currentTime = newTime;
         // get events
         glfwPollEvents();
+        // memory budget
+        lveDevice.getAllocator().updateBudget();
+#ifdef _DEBUG
+        if (newTime - lastMemoryReport >= std::chrono::seconds(5)) {
+            printMemoryBudgets(lveDevice.getAllocator());
+            if (gpuDriven) {
+                printGpuCulling(*gpuDrivenRenderSystem);
+            } else {
+                const auto& renderStats = simpleRenderSystem.getStats();
+                std::cout << "frustum culling: " << simpleRenderSystem.getCulledCount() << " of "
+                          << gameObjects.size() << " objects culled; " << renderStats.batchCount << " batches, "
+                          << renderStats.pipelineBinds << " pipeline binds (" << renderStats.pipelineBindsSkipped
+                          << " skipped), " << renderStats.geometryBinds << " geometry binds ("
+                          << renderStats.geometryBindsSkipped << " skipped)" << std::endl;
+            }
+            std::cout << "render pass: " << renderPassTimer.getMilliseconds() << " ms GPU, depth prepass "
+                      << (depthPrepass ? "on" : "off") << std::endl;
+            lastMemoryReport = newTime;
+        }
+#endif
+        // streaming
+        modelLoader.update();
+        modelRegistry.update();
+        bool modelsChanged = false;
+        bool streaming = false;
+        for (auto& obj : gameObjects) {
+            if (obj.pendingModel && obj.pendingModel->isResident()) {
+                obj.model = obj.pendingModel->get();
+                obj.pendingModel.reset();
+                modelsChanged = true;
+            } else if (obj.pendingModel && !obj.pendingModel->hasFailed()) {
+                streaming = true;
+            }
+        }
+        if (modelsChanged && gpuDrivenRenderSystem) {
+            gpuDrivenRenderSystem->setObjects(gameObjects);
+        }
+        bool prepassKeyPressed = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+        if (prepassKeyPressed && !prepassKeyDown && options.depthPrepass) {
+            depthPrepass = !depthPrepass;
+            simpleRenderSystem.setDepthPrepass(depthPrepass);
+            if (gpuDrivenRenderSystem) {
+                gpuDrivenRenderSystem->setDepthPrepass(depthPrepass);
+            }
+        }
+        prepassKeyDown = prepassKeyPressed;
+        bool pathKeyPressed = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_G) == GLFW_PRESS;
+        if (pathKeyPressed && !pathKeyDown && gpuDrivenRenderSystem) {
+            gpuDriven = !gpuDriven;
+            // objects only reach the GPU copy while its path is active, and the pyramid holds depth
+            // from before the switch
+            if (gpuDriven) {
+                gpuDrivenRenderSystem->setObjects(gameObjects);
+            }
+            gpuDrivenRenderSystem->resetDepthPyramid();
+        }
+        pathKeyDown = pathKeyPressed;
         // update
         camera.update(lveWindow.getGLFWwindow(), deltaTime);
         gameObjects[0].update(deltaTime);
+        if (gpuDriven) {
+            gpuDrivenRenderSystem->updateObject(0);
+        }
         // render
         if (auto commandBuffer = lveRenderer.beginFrame()) {
             int frameIndex = lveRenderer.getFrameIndex();
-            FrameInfo frameInfo{ frameIndex, deltaTime, commandBuffer, camera, globalDescriptorSets[frameIndex]};
-            // update
+            // the frame's fence was waited on by beginFrame, so its region can be reused
+            frameAllocator.beginFrame(frameIndex);
+            if (globalSetGenerations[frameIndex] != frameAllocator.getGeneration()) {
+                auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+                LveDescriptorWriter(*globalSetLayout, *globalPool)
+                    .writeBuffer(0, &bufferInfo)
+                    .overwrite(globalDescriptorSets[frameIndex]);
+                globalSetGenerations[frameIndex] = frameAllocator.getGeneration();
+            }
+            commandRecorder.beginFrame(frameIndex);
+            renderPassTimer.beginFrame(frameIndex);
+            // update; the first allocation of a frame always lands in the buffer the sets point at
             GlobalUbo ubo{};
             ubo.projection = camera.getProjection() * camera.getView();
-            ubobuffers[frameIndex]->writeToBuffer(&ubo);
-            ubobuffers[frameIndex]->flush();
+            uint32_t globalUboOffset = frameAllocator.push(ubo).dynamicOffset;
+            FrameInfo frameInfo{ frameIndex, deltaTime, commandBuffer, camera, globalDescriptorSets[frameIndex], globalUboOffset, frameAllocator, lveRenderer.getSwapChainExtent(),
+                                  lveRenderer.getSwapChainRenderPass(), lveRenderer.getCurrentFramebuffer()};
             // render
-            lveRenderer.beginSwapChainRenderPass(commandBuffer);
-            simpleRenderSystem.renderGameObjects(frameInfo, gameObjects);
+            if (gpuDriven) {
+                gpuDrivenRenderSystem->cull(frameInfo);
+            }
+            renderPassTimer.begin(commandBuffer, frameIndex);
+            lveRenderer.beginSwapChainRenderPass(
+                commandBuffer,
+                gpuDriven ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            if (gpuDriven) {
+                gpuDrivenRenderSystem->render(frameInfo);
+            } else {
+                simpleRenderSystem.renderGameObjects(frameInfo, gameObjects);
+            }
             lveRenderer.endSwapChainRenderPass(commandBuffer);
+            renderPassTimer.end(commandBuffer, frameIndex);
+            if (gpuDriven && occlusionCulling) {
+                gpuDrivenRenderSystem->buildDepthPyramid(
+                    frameInfo, lveRenderer.getDepthImage(), lveRenderer.getDepthImageView(), lveRenderer.getDepthFormat());
+            }
+            frameAllocator.flush();
             lveRenderer.endFrame();
         }
+        if (options.benchmarkFrames > 0 && !streaming) {
+            if (benchmarkFrameCount == 0) {
+                benchmarkStart = std::chrono::high_resolution_clock::now();
+            } else {
+                benchmarkRenderPassMilliseconds += renderPassTimer.getMilliseconds();
+                if (!gpuDriven) {
+                    benchmarkRecordMilliseconds += simpleRenderSystem.getStats().recordMilliseconds;
+                }
+            }
+            if (benchmarkFrameCount++ == options.benchmarkFrames) {
+                double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - benchmarkStart).count();
+                std::cout << "benchmark: " << gameObjects.size() << " objects, " << options.benchmarkFrames << " frames, "
+                          << seconds * 1000.0 / options.benchmarkFrames << " ms average frame time, "
+                          << benchmarkRenderPassMilliseconds / options.benchmarkFrames << " ms average GPU render pass, depth prepass "
+                          << (depthPrepass ? "on" : "off") << ", " << (gpuDriven ? "GPU driven" : "CPU") << " culling" << std::endl;
+                if (gpuDriven) {
+                    printGpuCulling(*gpuDrivenRenderSystem);
+                } else {
+                    std::cout << "recording: " << benchmarkRecordMilliseconds / options.benchmarkFrames << " ms average, "
+                              << simpleRenderSystem.getStats().batchCount << " batches on up to "
+                              << commandRecorder.getWorkerCount() << " workers" << std::endl;
+                }
+                std::cout << "frame allocator: " << frameAllocator.getFrameSize() / (1024.0 * 1024.0)
+                          << " MB per frame after " << frameAllocator.getGrowCount() << " grows, "
+                          << frameAllocator.getUsedBytes() / (1024.0 * 1024.0) << " MB used by the last frame" << std::endl;
+                break;
+            }
+        }
     }
 
     vkDeviceWaitIdle(lveDevice.device());
+
+#ifdef _DEBUG
+    const auto& registryStats = modelRegistry.getStats();
+    std::cout << "model registry: " << registryStats.hits << " hits, " << registryStats.misses << " misses, "
+              << registryStats.evictions << " evictions, " << registryStats.entryCount << " entries, "
+              << registryStats.residentBytes / (1024.0 * 1024.0) << " MB resident, "
+              << registryStats.indexBytesSaved / 1024.0 << " KB saved by 16-bit indices" << std::endl;
+    const auto allocatorStats = lveDevice.getAllocator().getStats();
+    std::cout << "allocator: " << allocatorStats.allocationCount << " sub-allocations in " << allocatorStats.blockCount
+              << " blocks (" << allocatorStats.usedBlockBytes / (1024.0 * 1024.0) << " of "
+              << allocatorStats.blockBytes / (1024.0 * 1024.0) << " MB used), "
+              << allocatorStats.dedicatedAllocationCount << " dedicated allocations, "
+              << allocatorStats.deviceMemoryCount << " device memory objects" << std::endl;
+    const auto& uploadStats = lveDevice.getUploadContext().getStats();
+    std::cout << "uploads: " << uploadStats.bytesUploaded / (1024.0 * 1024.0) << " MB in " << uploadStats.copyCount
+              << " copies, " << uploadStats.submitCount << " submits, " << uploadStats.stallCount << " stalls, "
+              << uploadStats.megabytesPerSecond() << " MB/s" << std::endl;
+    const auto geometryStats = lveDevice.getGeometryPool().getStats();
+    std::cout << "geometry pool: " << geometryStats.rangeCount << " ranges in " << geometryStats.arenaCount
+              << " arenas (" << geometryStats.usedBytes / (1024.0 * 1024.0) << " of "
+              << geometryStats.capacityBytes / (1024.0 * 1024.0) << " MB used), " << geometryStats.growCount
+              << " grows, " << geometryStats.compactCount << " compactions, "
+              << modelLoader.getBudgetDeferralCount() << " loader updates deferred by the memory budget" << std::endl;
+    printMemoryBudgets(lveDevice.getAllocator());
+#endif
 }
 
 void FirstApp::loadGameObjects() {
-    std::shared_ptr<LveModel> lveModel = LveModel::createModelFromFile(lveDevice, "models/flat_vase.obj");
+    ModelImportOptions importOptions{};
+    importOptions.positionStream = options.depthPrepass;
+
     auto flatVase = LveGameObject::createGameObject();
-    flatVase.model = lveModel;
+    flatVase.pendingModel = modelRegistry.acquire("models/flat_vase.obj", importOptions);
     flatVase.transform.translation = {-.5f, .5f, 2.5f};
     flatVase.transform.scale = {3.f, 1.5f, 3.f};
     //gameObjects.push_back(std::move(flatVase));
 
-    lveModel = LveModel::createModelFromFile(lveDevice, "models/smooth_vase.obj");
     auto smoothVase = LveGameObject::createGameObject();
-    smoothVase.model = lveModel;
+    smoothVase.pendingModel = modelRegistry.acquire("models/smooth_vase.obj", importOptions);
     smoothVase.transform.translation = {.5f, .5f, 2.5f};
     smoothVase.transform.scale = {3.f, 1.5f, 3.f};
     //gameObjects.push_back(std::move(smoothVase));
 
     auto tiger_1 = LveGameObject::createGameObject();
-    tiger_1.model = LveModel::createModelFromFile(lveDevice, "models/tanks/Tiger_I.obj");
+    tiger_1.pendingModel = modelRegistry.acquire("models/tanks/Tiger_I.obj", importOptions);
     tiger_1.transform.translation = { .0f, 1.0f, 3.0f };
     tiger_1.transform.rotation = { 0.0f, 0.0f, 0.0f };
     tiger_1.transform.scale = { 0.4f, 0.4f, 0.4f };
     //gameObjects.push_back(std::move(tiger_1));
 
     auto player = LveGameObject::createGameObject();
-    player.model = LveModel::createModelFromFile(lveDevice, "models/player.obj");
+    player.pendingModel = modelRegistry.acquire("models/player.obj", importOptions);
     player.transform.translation = { 0.0f, 0.0f, 0.0f };
     player.transform.rotation = { 0.0f, 0.0f, 0.0f };
     player.transform.scale = { 0.5f, 0.5f, 0.5f };
@@ -138,25 +349,42 @@ void FirstApp::loadGameObjects() {
     gameObjects.push_back(std::move(player));
 
     auto cube = LveGameObject::createGameObject();
-    cube.model = LveModel::createModelFromFile(lveDevice, "models/colored_cube.obj");
+    cube.pendingModel = modelRegistry.acquire("models/colored_cube.obj", importOptions);
     cube.transform.translation = { 2.0f, -1.0f, 0.0f };
     cube.transform.rotation = { 0.0f, 0.0f, 0.0f };
     cube.transform.scale = { 0.5f, 0.5f, 0.5f };
     //gameObjects.push_back(std::move(cube));
 
     auto viking_room = LveGameObject::createGameObject();
-    viking_room.model = LveModel::createModelFromFile(lveDevice, "models/viking_room.obj");
+    viking_room.pendingModel = modelRegistry.acquire("models/viking_room.obj", importOptions);
     viking_room.transform.translation = { 3.0f, -1.0f, 0.0f };
     viking_room.transform.rotation = { 3.14f / 2, 0.0f, 3.14f };
     viking_room.color = rgbToTheroOne(0, 162, 255);
     gameObjects.push_back(std::move(viking_room));
 
     auto plane = LveGameObject::createGameObject();
-    plane.model = LveModel::createModelFromFile(lveDevice, "models/plane.obj");
+    plane.pendingModel = modelRegistry.acquire("models/plane.obj", importOptions);
     plane.transform.translation = { 0.0f, 0.0f, 0.0f };
     plane.transform.rotation = { 0.0f, 0.0f, 0.0f };
     plane.color = rgbToTheroOne(73, 143, 100);
     gameObjects.push_back(std::move(plane));
+
+    // a block of small cubes for stress testing instancing, culling and the frame allocator
+    if (options.cubeCount > 0) {
+        auto cubeModel = modelRegistry.acquire("models/colored_cube.obj", importOptions);
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(options.cubeCount))));
+        const float spacing = 0.5f;
+        const glm::vec3 origin = glm::vec3{ -0.5f * spacing * (side - 1), -0.5f * spacing * (side - 1), 2.0f };
+        gameObjects.reserve(gameObjects.size() + options.cubeCount);
+        for (uint32_t i = 0; i < options.cubeCount; i++) {
+            auto stressCube = LveGameObject::createGameObject();
+            stressCube.pendingModel = cubeModel;
+            stressCube.transform.translation =
+                origin + spacing * glm::vec3{ static_cast<float>(i % side), static_cast<float>(i / side % side), static_cast<float>(i / (side * side)) };
+            stressCube.transform.scale = { 0.15f, 0.15f, 0.15f };
+            gameObjects.push_back(std::move(stressCube));
+        }
+    }
 }
 
 }  // namespace lve
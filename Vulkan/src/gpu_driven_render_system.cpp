@@ -0,0 +1,657 @@
+#include "gpu_driven_render_system.hpp"
+
+#include "lve_culling.hpp"
+#include "lve_deletion_queue.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_upload_context.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace lve {
+
+struct CullPushConstantData {
+  glm::vec4 frustumPlanes[Frustum::PLANE_COUNT];
+  glm::vec4 cameraPosition{};  // w: pixels per world unit at unit distance
+  uint32_t objectCount = 0;
+  uint32_t bucketCount = 0;
+  float maxPixelError = 1.f;
+  uint32_t perspective = 0;
+};
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+GpuDrivenRenderSystem::GpuDrivenRenderSystem(
+    LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    : lveDevice{device} {
+  if (!lveDevice.supportsDrawIndirectCount()) {
+    throw std::runtime_error("GPU driven rendering requires VK_KHR_draw_indirect_count!");
+  }
+  createPipelineLayouts(globalSetLayout);
+  // compact vertices are opt-in at import, so their pipelines wait until a model uses them
+  createPipelines(renderPass, VertexFormat::Float);
+  cullPipeline = std::make_unique<LvePipeline>(lveDevice, "shaders/bin/cull.comp.spv", cullPipelineLayout);
+}
+
+GpuDrivenRenderSystem::~GpuDrivenRenderSystem() {
+  LveDeletionQueue& deletionQueue = lveDevice.getDeletionQueue();
+  for (StorageBuffer* storage : {&instanceBuffer, &boundsBuffer, &meshBuffer, &lodBuffer, &drawBuffer}) {
+    if (storage->buffer != VK_NULL_HANDLE) {
+      deletionQueue.destroyBuffer(storage->buffer, storage->allocation);
+    }
+  }
+  for (auto& frame : frames) {
+    for (StorageBuffer* storage : {&frame.commands, &frame.depthCommands, &frame.counts, &frame.readback, &frame.uniforms}) {
+      if (storage->buffer != VK_NULL_HANDLE) {
+        deletionQueue.destroyBuffer(storage->buffer, storage->allocation);
+      }
+    }
+  }
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+  vkDestroyPipelineLayout(lveDevice.device(), cullPipelineLayout, nullptr);
+}
+
+void GpuDrivenRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout) {
+  // the instanced shaders take everything per object from the instance stream
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &globalSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  cullSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
+      .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .build();
+  cullPool = LveDescriptorPool::Builder(lveDevice)
+      .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+      .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+      .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+      .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+      .build();
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(CullPushConstantData);
+
+  VkDescriptorSetLayout cullDescriptorSetLayout = cullSetLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo cullLayoutInfo{};
+  cullLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  cullLayoutInfo.setLayoutCount = 1;
+  cullLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+  cullLayoutInfo.pushConstantRangeCount = 1;
+  cullLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &cullLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+void GpuDrivenRenderSystem::createPipelines(VkRenderPass renderPass, VertexFormat format) {
+  assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+  const bool compact = format == VertexFormat::Compact;
+  const std::string vertFilepath =
+      compact ? "shaders/bin/simple_shader_compact_instanced.vert.spv" : "shaders/bin/simple_shader_instanced.vert.spv";
+
+  PipelineConfigInfo pipelineConfig{};
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.renderPass = renderPass;
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  pipelineConfig.bindingDescriptions = LveModel::Vertex::getBindingDescriptions(format);
+  pipelineConfig.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions(format);
+  SimpleRenderSystem::addInstanceInputs(pipelineConfig);
+  (compact ? compactInstancedPipeline : instancedPipeline) =
+      std::make_unique<LvePipeline>(lveDevice, vertFilepath, "shaders/bin/simple_shader.frag.spv", pipelineConfig);
+
+  // shading after the depth prepass
+  LvePipeline::depthEqualPipelineConfigInfo(pipelineConfig);
+  (compact ? compactDepthEqualPipeline : depthEqualPipeline) =
+      std::make_unique<LvePipeline>(lveDevice, vertFilepath, "shaders/bin/simple_shader.frag.spv", pipelineConfig);
+
+  // the depth prepass reads the position stream, whose vertex input depends on the format only
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  LvePipeline::depthOnlyPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.bindingDescriptions = LveModel::Vertex::getBindingDescriptions(format, VertexStream::Position);
+  pipelineConfig.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions(format, VertexStream::Position);
+  SimpleRenderSystem::addInstanceInputs(pipelineConfig);
+  (compact ? compactDepthOnlyPipeline : depthOnlyPipeline) =
+      std::make_unique<LvePipeline>(lveDevice, "shaders/bin/depth_only_instanced.vert.spv", "", pipelineConfig);
+}
+
+void GpuDrivenRenderSystem::setObjects(std::vector<LveGameObject>& objects) {
+  gameObjects = &objects;
+  rebuild();
+}
+
+void GpuDrivenRenderSystem::updateObject(uint32_t index) {
+  if (index < objectSlots.size() && objectSlots[index] != INVALID_SLOT) {
+    dirtySlots.push_back(objectSlots[index]);
+  }
+}
+
+void GpuDrivenRenderSystem::rebuild() {
+  std::vector<LveGameObject>& objects = *gameObjects;
+  objectIndices.clear();
+  objectSlots.assign(objects.size(), INVALID_SLOT);
+  objectMeshes.clear();
+  dirtySlots.clear();
+  buckets.clear();
+  positionStreams = true;
+
+  std::vector<GpuMesh> meshes;
+  std::vector<GpuLod> lods;
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  std::vector<uint32_t> meshMaxDraws;
+  std::unordered_map<const LveModel*, uint32_t> meshIndices;
+  for (uint32_t i = 0; i < objects.size(); i++) {
+    const LveModel* model = objects[i].model.get();
+    if (model == nullptr || !model->isIndexed()) {
+      continue;
+    }
+
+    auto inserted = meshIndices.emplace(model, static_cast<uint32_t>(meshes.size()));
+    if (inserted.second) {
+      GpuMesh mesh{};
+      mesh.firstLod = static_cast<uint32_t>(lods.size());
+      mesh.lodCount = model->getLodCount();
+      mesh.bucket = static_cast<uint32_t>(buckets.size());
+      VkBuffer positionBuffer =
+          model->hasPositionStream() ? model->getVertexBuffer(VertexStream::Position) : VK_NULL_HANDLE;
+      positionStreams = positionStreams && model->hasPositionStream();
+      for (uint32_t b = 0; b < buckets.size(); b++) {
+        const Bucket& bucket = buckets[b];
+        if (bucket.vertexFormat == model->getVertexFormat() && bucket.vertexBuffer == model->getVertexBuffer() &&
+            bucket.positionBuffer == positionBuffer &&
+            bucket.indexBuffer == model->getIndexBuffer() && bucket.indexType == model->getIndexType()) {
+          mesh.bucket = b;
+          break;
+        }
+      }
+      if (mesh.bucket == buckets.size()) {
+        buckets.push_back(
+            {model->getVertexFormat(),
+             model->getVertexBuffer(),
+             positionBuffer,
+             model->getIndexBuffer(),
+             model->getIndexType(),
+             0,
+             0});
+      }
+
+      uint32_t maxDraws = 0;
+      for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+        GpuLod gpuLod{};
+        gpuLod.error = model->getLodError(lod);
+        gpuLod.firstDraw = static_cast<uint32_t>(draws.size());
+        model->getIndirectCommands(lod, draws);
+        gpuLod.drawCount = static_cast<uint32_t>(draws.size()) - gpuLod.firstDraw;
+        gpuLod.firstPositionDraw = gpuLod.firstDraw;
+        if (model->hasPositionStream()) {
+          gpuLod.firstPositionDraw = static_cast<uint32_t>(draws.size());
+          model->getIndirectCommands(lod, draws, VertexStream::Position);
+        }
+        maxDraws = std::max(maxDraws, gpuLod.drawCount);
+        lods.push_back(gpuLod);
+      }
+      meshes.push_back(mesh);
+      meshMaxDraws.push_back(maxDraws);
+    }
+
+    uint32_t meshIndex = inserted.first->second;
+    buckets[meshes[meshIndex].bucket].maxDrawCount += meshMaxDraws[meshIndex];
+    objectSlots[i] = static_cast<uint32_t>(objectIndices.size());
+    objectIndices.push_back(i);
+    objectMeshes.push_back(meshIndex);
+  }
+
+  geometryGeneration = lveDevice.getGeometryPool().getGeneration();
+  objectsGeneration++;
+  if (objectIndices.empty()) {
+    return;
+  }
+
+  // every bucket gets room for all of its objects at their most fragmented LOD
+  commandCapacity = 0;
+  for (auto& bucket : buckets) {
+    bucket.firstCommand = commandCapacity;
+    commandCapacity += bucket.maxDrawCount;
+  }
+  for (auto& mesh : meshes) {
+    mesh.firstCommand = buckets[mesh.bucket].firstCommand;
+  }
+
+  std::vector<InstanceData> instances(objectIndices.size());
+  std::vector<ObjectBounds> bounds(objectIndices.size());
+  for (uint32_t slot = 0; slot < objectIndices.size(); slot++) {
+    writeObject(slot, instances[slot], bounds[slot]);
+  }
+
+  uploadStorageBuffer(
+      instanceBuffer,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      instances.data(),
+      instances.size() * sizeof(InstanceData));
+  uploadStorageBuffer(
+      boundsBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bounds.data(), bounds.size() * sizeof(ObjectBounds));
+  uploadStorageBuffer(
+      meshBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshes.data(), meshes.size() * sizeof(GpuMesh));
+  uploadStorageBuffer(lodBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lods.data(), lods.size() * sizeof(GpuLod));
+  uploadStorageBuffer(
+      drawBuffer,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      draws.data(),
+      draws.size() * sizeof(VkDrawIndexedIndirectCommand));
+  LveUploadContext& uploadContext = lveDevice.getUploadContext();
+  uploadContext.wait(uploadContext.flush());
+}
+
+void GpuDrivenRenderSystem::writeObject(uint32_t slot, InstanceData& instance, ObjectBounds& bounds) {
+  LveGameObject& obj = (*gameObjects)[objectIndices[slot]];
+  const LveModel& model = *obj.model;
+  const glm::mat4 modelMatrix = obj.transform.mat4();
+  const glm::mat3 normalMatrix = obj.transform.normalMatrix();
+
+  // compact positions are dequantized by folding the bounds into the model matrix
+  instance.modelMatrix = modelMatrix * model.getDequantizationMatrix();
+  instance.normalMatrix[0] = glm::vec4(normalMatrix[0], 0.f);
+  instance.normalMatrix[1] = glm::vec4(normalMatrix[1], 0.f);
+  instance.normalMatrix[2] = glm::vec4(normalMatrix[2], 0.f);
+  instance.color = glm::vec4(obj.color, 1.f);
+
+  glm::vec3 scale = glm::abs(obj.transform.scale);
+  float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+  glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.getBoundingCenter(), 1.f));
+  bounds = {};
+  bounds.sphere = glm::vec4(center, model.getBoundingRadius() * maxScale);
+  bounds.meshIndex = objectMeshes[slot];
+  bounds.maxScale = maxScale;
+}
+
+void GpuDrivenRenderSystem::uploadStorageBuffer(
+    StorageBuffer& storage, VkBufferUsageFlags usage, const void* data, VkDeviceSize size) {
+  // frames in flight may still read the previous contents
+  if (storage.buffer != VK_NULL_HANDLE) {
+    lveDevice.getDeletionQueue().destroyBuffer(storage.buffer, storage.allocation);
+  }
+  lveDevice.createBuffer(
+      size,
+      usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      storage.buffer,
+      storage.allocation,
+      true);
+  storage.size = size;
+  lveDevice.getUploadContext().uploadBuffer(storage.buffer, 0, data, size, true);
+}
+
+void GpuDrivenRenderSystem::ensureFrameBuffer(
+    StorageBuffer& storage, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size) {
+  if (storage.buffer != VK_NULL_HANDLE && storage.size >= size) {
+    return;
+  }
+  if (storage.buffer != VK_NULL_HANDLE) {
+    lveDevice.getDeletionQueue().destroyBuffer(storage.buffer, storage.allocation);
+  }
+  lveDevice.createBuffer(size, usage, properties, storage.buffer, storage.allocation);
+  storage.size = size;
+}
+
+void GpuDrivenRenderSystem::prepareFrame(FrameResources& frame) {
+  VkDeviceSize commandBytes = static_cast<VkDeviceSize>(commandCapacity) * sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize countBytes = (buckets.size() + 2) * sizeof(uint32_t);
+  ensureFrameBuffer(
+      frame.commands,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      commandBytes);
+  ensureFrameBuffer(
+      frame.depthCommands,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      commandBytes);
+  ensureFrameBuffer(
+      frame.counts,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      countBytes);
+  ensureFrameBuffer(
+      frame.readback,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      countBytes);
+  ensureFrameBuffer(
+      frame.uniforms,
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      sizeof(CullUniformData));
+
+  VkDescriptorBufferInfo bufferInfos[6] = {
+      {boundsBuffer.buffer, 0, boundsBuffer.size},
+      {meshBuffer.buffer, 0, meshBuffer.size},
+      {lodBuffer.buffer, 0, lodBuffer.size},
+      {drawBuffer.buffer, 0, drawBuffer.size},
+      {frame.commands.buffer, 0, commandBytes},
+      {frame.counts.buffer, 0, countBytes}};
+  VkDescriptorImageInfo pyramidInfo = depthPyramid->getDescriptorInfo();
+  VkDescriptorBufferInfo uniformInfo{frame.uniforms.buffer, 0, sizeof(CullUniformData)};
+  VkDescriptorBufferInfo depthCommandInfo{frame.depthCommands.buffer, 0, commandBytes};
+  LveDescriptorWriter writer{*cullSetLayout, *cullPool};
+  for (uint32_t binding = 0; binding < 6; binding++) {
+    writer.writeBuffer(binding, &bufferInfos[binding]);
+  }
+  writer.writeImage(6, &pyramidInfo);
+  writer.writeBuffer(7, &uniformInfo);
+  writer.writeBuffer(8, &depthCommandInfo);
+  // the frame's last submission has completed, so its set can be rewritten in place
+  if (frame.descriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(frame.descriptorSet)) {
+      throw std::runtime_error("failed to allocate culling descriptor set!");
+    }
+  } else {
+    writer.overwrite(frame.descriptorSet);
+  }
+
+  frame.generation = objectsGeneration;
+  frame.pyramidGeneration = pyramidGeneration;
+}
+
+void GpuDrivenRenderSystem::cull(FrameInfo& frameInfo) {
+  FrameResources& frame = frames[frameInfo.frameIndex];
+  // beginFrame waited on this frame's fence, so the counts it copied back are final
+  if (frame.pendingReadback) {
+    const uint32_t* counts = static_cast<const uint32_t*>(frame.readback.allocation.mappedData);
+    drawCount = 0;
+    for (uint32_t b = 0; b < frame.readbackBucketCount; b++) {
+      drawCount += counts[b];
+    }
+    visibleCount = counts[frame.readbackBucketCount];
+    occludedCount = counts[frame.readbackBucketCount + 1];
+    frame.pendingReadback = false;
+    if (frame.hasReference) {
+      referenceCount = frame.referenceCount;
+      referenceCheckCount++;
+      if (visibleCount + occludedCount != referenceCount) {
+        referenceMismatchCount++;
+      }
+    }
+  }
+
+  if (gameObjects == nullptr) {
+    return;
+  }
+  // draw offsets and geometry buffers move when the pool grows or compacts
+  if (geometryGeneration != lveDevice.getGeometryPool().getGeneration()) {
+    rebuild();
+  }
+  if (objectIndices.empty()) {
+    visibleCount = 0;
+    occludedCount = 0;
+    drawCount = 0;
+    return;
+  }
+  // the culling set always needs a pyramid to point at; it is ignored until the first build
+  if (depthPyramid == nullptr) {
+    depthPyramid = std::make_unique<LveDepthPyramid>(lveDevice, frameInfo.extent);
+    pyramidGeneration++;
+  }
+  if (frame.generation != objectsGeneration || frame.pyramidGeneration != pyramidGeneration) {
+    prepareFrame(frame);
+  }
+
+  CullUniformData* uniforms = static_cast<CullUniformData*>(frame.uniforms.allocation.mappedData);
+  uniforms->viewProjection = depthPyramid->getViewProjection();
+  VkExtent2D pyramidExtent = depthPyramid->getExtent();
+  uniforms->pyramidSize =
+      glm::vec2(static_cast<float>(pyramidExtent.width), static_cast<float>(pyramidExtent.height));
+  uniforms->levelCount = depthPyramid->getLevelCount();
+  uniforms->occlusionCulling = occlusionCulling && depthPyramid->isValid() ? 1 : 0;
+  frame.depthPrepass = depthPrepass && positionStreams;
+  uniforms->depthPrepass = frame.depthPrepass ? 1 : 0;
+
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+  if (!dirtySlots.empty()) {
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+
+    // earlier frames may still be reading the object data
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        0,
+        nullptr);
+    for (uint32_t slot : dirtySlots) {
+      InstanceData instance;
+      ObjectBounds bounds;
+      writeObject(slot, instance, bounds);
+      vkCmdUpdateBuffer(commandBuffer, instanceBuffer.buffer, slot * sizeof(InstanceData), sizeof(InstanceData), &instance);
+      vkCmdUpdateBuffer(commandBuffer, boundsBuffer.buffer, slot * sizeof(ObjectBounds), sizeof(ObjectBounds), &bounds);
+    }
+    dirtySlots.clear();
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  vkCmdFillBuffer(commandBuffer, frame.counts.buffer, 0, VK_WHOLE_SIZE, 0);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  // world-space error e at distance d covers e * pixelsPerUnit / d pixels, as in SimpleRenderSystem
+  const glm::mat4& projection = frameInfo.camera.getProjection();
+  Frustum frustum = frameInfo.camera.getFrustum();
+  CullPushConstantData push{};
+  for (uint32_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+    push.frustumPlanes[i] = frustum.planes[i];
+  }
+  push.cameraPosition = glm::vec4(
+      frameInfo.camera.getPosition(),
+      glm::abs(projection[1][1]) * 0.5f * static_cast<float>(frameInfo.extent.height));
+  push.objectCount = static_cast<uint32_t>(objectIndices.size());
+  push.bucketCount = static_cast<uint32_t>(buckets.size());
+  push.maxPixelError = maxLodPixelError;
+  push.perspective = projection[2][3] != 0.f ? 1 : 0;
+
+  // the same sphere test as cull.comp, on the bounds the dirty objects were just updated with
+  frame.hasReference = cpuReference;
+  if (cpuReference) {
+    frame.referenceCount = 0;
+    for (uint32_t slot = 0; slot < objectIndices.size(); slot++) {
+      InstanceData instance;
+      ObjectBounds bounds;
+      writeObject(slot, instance, bounds);
+      bool inside = true;
+      for (uint32_t i = 0; i < Frustum::PLANE_COUNT && inside; i++) {
+        const glm::vec4& plane = push.frustumPlanes[i];
+        inside = glm::dot(glm::vec3(plane), glm::vec3(bounds.sphere)) + plane.w >= -bounds.sphere.w;
+      }
+      frame.referenceCount += inside ? 1 : 0;
+    }
+  }
+
+  cullPipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(
+      commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+  vkCmdPushConstants(
+      commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &push);
+  vkCmdDispatch(commandBuffer, (push.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  // read back on the frame's next use, once its fence has signaled
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = 0;
+  copyRegion.dstOffset = 0;
+  copyRegion.size = (buckets.size() + 2) * sizeof(uint32_t);
+  vkCmdCopyBuffer(commandBuffer, frame.counts.buffer, frame.readback.buffer, 1, &copyRegion);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+  frame.pendingReadback = true;
+  frame.readbackBucketCount = static_cast<uint32_t>(buckets.size());
+}
+
+void GpuDrivenRenderSystem::buildDepthPyramid(
+    FrameInfo& frameInfo, VkImage depthImage, VkImageView depthImageView, VkFormat depthFormat) {
+  if (objectIndices.empty() || depthPyramid == nullptr) {
+    return;
+  }
+  VkExtent2D depthExtent = depthPyramid->getDepthExtent();
+  if (depthExtent.width != frameInfo.extent.width || depthExtent.height != frameInfo.extent.height) {
+    // the old pyramid is released through the deletion queue once no frame can sample it
+    depthPyramid = std::make_unique<LveDepthPyramid>(lveDevice, frameInfo.extent);
+    pyramidGeneration++;
+  }
+
+  const LveCamera& camera = frameInfo.camera;
+  depthPyramid->build(
+      frameInfo.commandBuffer,
+      depthImage,
+      depthImageView,
+      depthFormat,
+      camera.getProjection() * camera.getView());
+}
+
+void GpuDrivenRenderSystem::render(FrameInfo& frameInfo) {
+  if (objectIndices.empty()) {
+    return;
+  }
+  FrameResources& frame = frames[frameInfo.frameIndex];
+  if (compactInstancedPipeline == nullptr) {
+    for (const Bucket& bucket : buckets) {
+      if (bucket.vertexFormat == VertexFormat::Compact) {
+        createPipelines(frameInfo.renderPass, VertexFormat::Compact);
+        break;
+      }
+    }
+  }
+
+  vkCmdBindDescriptorSets(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      0,
+      1,
+      &frameInfo.globalDescriptorSet,
+      1,
+      &frameInfo.globalUboOffset);
+
+  // firstInstance of every generated draw is the object's slot in the instance buffer
+  VkDeviceSize instanceOffset = 0;
+  vkCmdBindVertexBuffers(frameInfo.commandBuffer, SimpleRenderSystem::INSTANCE_BINDING, 1, &instanceBuffer.buffer, &instanceOffset);
+
+  // the prepass lays down depth from the position stream; shading then only passes depth EQUAL,
+  // so every covered pixel runs the fragment shader once
+  auto drawBuckets = [&](bool depthOnly, const StorageBuffer& commands) {
+    LvePipeline* boundPipeline = nullptr;
+    for (uint32_t b = 0; b < buckets.size(); b++) {
+      const Bucket& bucket = buckets[b];
+      bool compact = bucket.vertexFormat == VertexFormat::Compact;
+      LvePipeline* pipeline;
+      if (depthOnly) {
+        pipeline = (compact ? compactDepthOnlyPipeline : depthOnlyPipeline).get();
+      } else if (frame.depthPrepass) {
+        pipeline = (compact ? compactDepthEqualPipeline : depthEqualPipeline).get();
+      } else {
+        pipeline = (compact ? compactInstancedPipeline : instancedPipeline).get();
+      }
+      if (pipeline != boundPipeline) {
+        boundPipeline = pipeline;
+        pipeline->bind(frameInfo.commandBuffer);
+      }
+
+      VkDeviceSize vertexOffset = 0;
+      VkBuffer vertexBuffer = depthOnly ? bucket.positionBuffer : bucket.vertexBuffer;
+      vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, &vertexBuffer, &vertexOffset);
+      vkCmdBindIndexBuffer(frameInfo.commandBuffer, bucket.indexBuffer, 0, bucket.indexType);
+      lveDevice.cmdDrawIndexedIndirectCount()(
+          frameInfo.commandBuffer,
+          commands.buffer,
+          static_cast<VkDeviceSize>(bucket.firstCommand) * sizeof(VkDrawIndexedIndirectCommand),
+          frame.counts.buffer,
+          static_cast<VkDeviceSize>(b) * sizeof(uint32_t),
+          bucket.maxDrawCount,
+          sizeof(VkDrawIndexedIndirectCommand));
+    }
+  };
+
+  if (frame.depthPrepass) {
+    drawBuckets(true, frame.depthCommands);
+  }
+  drawBuckets(false, frame.commands);
+}
+
+}  // namespace lve
@@ -0,0 +1,337 @@
+#include "lve_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) { return value / alignment * alignment; }
+
+}  // namespace
+
+const char *getMemoryCategoryName(LveMemoryCategory category) {
+  switch (category) {
+    case LveMemoryCategory::Geometry:
+      return "geometry";
+    case LveMemoryCategory::Staging:
+      return "staging";
+    case LveMemoryCategory::Uniform:
+      return "uniform";
+    case LveMemoryCategory::Texture:
+      return "texture";
+    case LveMemoryCategory::RenderTarget:
+      return "render target";
+    default:
+      return "other";
+  }
+}
+
+LveAllocator::LveAllocator(VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudgetSupported)
+    : physicalDevice{physicalDevice}, device{device}, memoryBudgetSupported{memoryBudgetSupported} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+  updateBudget();
+}
+
+LveAllocator::~LveAllocator() {
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      vkFreeMemory(device, block->memory, nullptr);
+    }
+  }
+}
+
+uint32_t LveAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+
+  throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool LveAllocator::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return true;
+    }
+  }
+  return false;
+}
+
+LveAllocation LveAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties,
+    ResourceType type,
+    LveMemoryCategory category) {
+  uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+  // keep non-coherent allocations atom aligned so flushing one never touches its neighbours
+  VkDeviceSize size = requirements.size;
+  VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+  if (!isCoherent(memoryTypeIndex)) {
+    size = alignUp(size, nonCoherentAtomSize);
+    alignment = alignUp(alignment, nonCoherentAtomSize);
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+
+  LveAllocation allocation{};
+  allocation.poolIndex = memoryTypeIndex * 2 + (type == ResourceType::Image ? 1 : 0);
+  allocation.category = category;
+
+  // lazily allocated memory is committed per VkDeviceMemory, so it must not share blocks
+  VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+  bool lazy = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+  if (lazy || size >= blockSize / 2) {
+    allocation.memory = allocateDeviceMemory(size, memoryTypeIndex, &allocation.mappedData);
+    allocation.size = size;
+    allocation.dedicated = true;
+    heaps[getHeapIndex(memoryTypeIndex)].categoryBytes[static_cast<uint32_t>(category)] += size;
+    stats.dedicatedAllocationCount++;
+    stats.dedicatedBytes += size;
+    return allocation;
+  }
+
+  Pool &pool = pools[allocation.poolIndex];
+  for (auto &block : pool.blocks) {
+    if (allocateFromBlock(*block, size, alignment, allocation)) {
+      return allocation;
+    }
+  }
+
+  auto block = std::make_unique<Block>();
+  block->size = blockSize;
+  block->memory = allocateDeviceMemory(blockSize, memoryTypeIndex, &block->mapped);
+  block->freeList = LveFreeList{blockSize};
+  stats.blockCount++;
+  stats.blockBytes += blockSize;
+
+  allocateFromBlock(*block, size, alignment, allocation);
+  pool.blocks.push_back(std::move(block));
+  return allocation;
+}
+
+void LveAllocator::free(LveAllocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+
+  uint32_t memoryTypeIndex = allocation.poolIndex / 2;
+  heaps[getHeapIndex(memoryTypeIndex)].categoryBytes[static_cast<uint32_t>(allocation.category)] -=
+      allocation.size;
+
+  if (allocation.dedicated) {
+    freeDeviceMemory(allocation.memory, allocation.size, memoryTypeIndex);
+    stats.dedicatedAllocationCount--;
+    stats.dedicatedBytes -= allocation.size;
+    allocation = LveAllocation{};
+    return;
+  }
+
+  Pool &pool = pools[allocation.poolIndex];
+  auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [&](const auto &block) {
+    return block->memory == allocation.memory;
+  });
+  if (it == pool.blocks.end()) {
+    throw std::runtime_error("freed allocation does not belong to this allocator!");
+  }
+
+  Block &block = **it;
+  block.freeList.free(allocation.offset, allocation.size);
+  block.allocationCount--;
+  stats.allocationCount--;
+  stats.usedBlockBytes -= allocation.size;
+
+  // keep the last block of a pool around so a pool that drains and refills does not thrash
+  if (block.allocationCount == 0 && pool.blocks.size() > 1) {
+    freeDeviceMemory(block.memory, block.size, memoryTypeIndex);
+    stats.blockCount--;
+    stats.blockBytes -= block.size;
+    pool.blocks.erase(it);
+  }
+  allocation = LveAllocation{};
+}
+
+VkResult LveAllocator::flush(const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+  if (isCoherent(allocation.poolIndex / 2)) {
+    return VK_SUCCESS;
+  }
+  VkMappedMemoryRange range = makeMappedRange(allocation, offset, size);
+  return vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+VkResult LveAllocator::invalidate(const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+  if (isCoherent(allocation.poolIndex / 2)) {
+    return VK_SUCCESS;
+  }
+  VkMappedMemoryRange range = makeMappedRange(allocation, offset, size);
+  return vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+LveAllocator::Stats LveAllocator::getStats() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  return stats;
+}
+
+void LveAllocator::updateBudget() {
+  std::lock_guard<std::mutex> lock{mutex};
+
+  if (!memoryBudgetSupported) {
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+      heaps[i].queriedBudget = memoryProperties.memoryHeaps[i].size / 10 * 8;
+      heaps[i].queriedUsage = heaps[i].deviceMemoryBytes;
+      heaps[i].deviceMemoryBytesAtQuery = heaps[i].deviceMemoryBytes;
+    }
+    return;
+  }
+
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+  memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  memoryProperties2.pNext = &budgetProperties;
+  vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    heaps[i].queriedBudget = budgetProperties.heapBudget[i];
+    heaps[i].queriedUsage = budgetProperties.heapUsage[i];
+    heaps[i].deviceMemoryBytesAtQuery = heaps[i].deviceMemoryBytes;
+  }
+}
+
+std::vector<LveAllocator::HeapBudget> LveAllocator::getHeapBudgets() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  std::vector<HeapBudget> budgets;
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    budgets.push_back(makeHeapBudget(i));
+  }
+  return budgets;
+}
+
+bool LveAllocator::isWithinSoftBudget(VkMemoryPropertyFlags properties, VkDeviceSize size) const {
+  uint32_t heapIndex = getHeapIndex(findMemoryType(~0u, properties));
+  std::lock_guard<std::mutex> lock{mutex};
+  HeapBudget budget = makeHeapBudget(heapIndex);
+  return budget.usage + size <= budget.softBudget;
+}
+
+void LveAllocator::setSoftBudgetFraction(float fraction) {
+  std::lock_guard<std::mutex> lock{mutex};
+  softBudgetFraction = fraction;
+}
+
+VkDeviceMemory LveAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped) {
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory!");
+  }
+
+  *mapped = nullptr;
+  if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+      vkFreeMemory(device, memory, nullptr);
+      throw std::runtime_error("failed to map device memory!");
+    }
+  }
+
+  stats.deviceMemoryCount++;
+  heaps[getHeapIndex(memoryTypeIndex)].deviceMemoryBytes += size;
+  return memory;
+}
+
+void LveAllocator::freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex) {
+  // freeing implicitly unmaps
+  vkFreeMemory(device, memory, nullptr);
+  stats.deviceMemoryCount--;
+  heaps[getHeapIndex(memoryTypeIndex)].deviceMemoryBytes -= size;
+}
+
+LveAllocator::HeapBudget LveAllocator::makeHeapBudget(uint32_t heapIndex) const {
+  const HeapState &heap = heaps[heapIndex];
+  HeapBudget budget{};
+  budget.flags = memoryProperties.memoryHeaps[heapIndex].flags;
+  budget.size = memoryProperties.memoryHeaps[heapIndex].size;
+  budget.budget = heap.queriedBudget;
+  // the driver value may lag behind our own allocations and frees since the query
+  if (heap.deviceMemoryBytes >= heap.deviceMemoryBytesAtQuery) {
+    budget.usage = heap.queriedUsage + (heap.deviceMemoryBytes - heap.deviceMemoryBytesAtQuery);
+  } else {
+    VkDeviceSize freed = heap.deviceMemoryBytesAtQuery - heap.deviceMemoryBytes;
+    budget.usage = heap.queriedUsage > freed ? heap.queriedUsage - freed : 0;
+  }
+  budget.softBudget = static_cast<VkDeviceSize>(heap.queriedBudget * static_cast<double>(softBudgetFraction));
+  budget.deviceMemoryBytes = heap.deviceMemoryBytes;
+  std::copy(std::begin(heap.categoryBytes), std::end(heap.categoryBytes), budget.categoryBytes);
+  return budget;
+}
+
+bool LveAllocator::allocateFromBlock(
+    Block &block, VkDeviceSize size, VkDeviceSize alignment, LveAllocation &allocation) {
+  VkDeviceSize offset;
+  if (!block.freeList.allocate(size, alignment, offset)) {
+    return false;
+  }
+
+  allocation.memory = block.memory;
+  allocation.offset = offset;
+  allocation.size = size;
+  allocation.mappedData = block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+  block.allocationCount++;
+  heaps[getHeapIndex(allocation.poolIndex / 2)].categoryBytes[static_cast<uint32_t>(allocation.category)] += size;
+  stats.allocationCount++;
+  stats.usedBlockBytes += size;
+  return true;
+}
+
+VkDeviceSize LveAllocator::getBlockSize(uint32_t memoryTypeIndex) const {
+  uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+  // small heaps such as the 256 MB host visible device local window get proportionally small blocks
+  return heapSize <= 1024ull * 1024 * 1024 ? alignUp(heapSize / 8, 1024) : DEFAULT_BLOCK_SIZE;
+}
+
+VkMappedMemoryRange LveAllocator::makeMappedRange(
+    const LveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const {
+  if (size == VK_WHOLE_SIZE) {
+    size = allocation.size - offset;
+  }
+
+  VkDeviceSize begin = alignDown(allocation.offset + offset, nonCoherentAtomSize);
+  VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+  VkMappedMemoryRange range{};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = allocation.memory;
+  range.offset = begin;
+  range.size = end - begin;
+  return range;
+}
+
+bool LveAllocator::isCoherent(uint32_t memoryTypeIndex) const {
+  return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+}  // namespace lve
@@ -1,5 +1,7 @@
 #include "lve_buffer.hpp"
 
+#include "lve_deletion_queue.hpp"
+
 #include <cassert>
 #include <cstring>
 
@@ -35,18 +37,21 @@ LveBuffer::LveBuffer(
     memoryPropertyFlags{ memoryPropertyFlags } {
     alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     bufferSize = alignmentSize * instanceCount;
-    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 }
 
 LveBuffer::~LveBuffer() {
     unmap();
-    vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-    vkFreeMemory(lveDevice.device(), memory, nullptr);
+    // frames in flight may still read the buffer
+    lveDevice.getDeletionQueue().destroyBuffer(buffer, allocation);
 }
 
 /**
     * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
     *
+    * @note Host visible memory is persistently mapped by the allocator, so this only hands out a
+    * pointer into the mapping
+    *
     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
     * buffer range.
     * @param offset (Optional) Byte offset from beginning
@@ -54,20 +59,21 @@ LveBuffer::~LveBuffer() {
     * @return VkResult of the buffer mapping call
     */
 VkResult LveBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-    assert(buffer && memory && "Called map on buffer before create");
-    return vkMapMemory(lveDevice.device(), memory, offset, size, 0, &mapped);
+    assert(buffer && allocation.memory && "Called map on buffer before create");
+    if (!allocation.mappedData) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    mapped = static_cast<char*>(allocation.mappedData) + offset;
+    return VK_SUCCESS;
 }
 
 /**
     * Unmap a mapped memory range
     *
-    * @note Does not return a result as vkUnmapMemory can't fail
+    * @note Does not return a result as unmapping can't fail
     */
 void LveBuffer::unmap() {
-    if (mapped) {
-        vkUnmapMemory(lveDevice.device(), memory);
-        mapped = nullptr;
-    }
+    mapped = nullptr;
 }
 
 /**
@@ -104,12 +110,7 @@ void LveBuffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset
     * @return VkResult of the flush call
     */
 VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+    return lveDevice.getAllocator().flush(allocation, offset, size);
 }
 
 /**
@@ -124,12 +125,7 @@ VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
     * @return VkResult of the invalidate call
     */
 VkResult LveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+    return lveDevice.getAllocator().invalidate(allocation, offset, size);
 }
 
 /**
@@ -0,0 +1,118 @@
+#include "lve_command_recorder.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace lve {
+
+LveCommandRecorder::LveCommandRecorder(LveDevice &device, uint32_t workerCount)
+    : lveDevice{device}, workerCount{std::max(workerCount, 1u)}, threadPool{std::max(workerCount, 2u) - 1} {
+  QueueFamilyIndices queueFamilyIndices = lveDevice.findPhysicalQueueFamilies();
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  for (auto &workers : frames) {
+    workers.resize(this->workerCount);
+    for (auto &worker : workers) {
+      if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &worker.commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
+      }
+    }
+  }
+}
+
+LveCommandRecorder::~LveCommandRecorder() {
+  // destroying a pool frees its command buffers
+  for (auto &workers : frames) {
+    for (auto &worker : workers) {
+      vkDestroyCommandPool(lveDevice.device(), worker.commandPool, nullptr);
+    }
+  }
+}
+
+void LveCommandRecorder::beginFrame(int frameIndex) {
+  currentFrameIndex = frameIndex;
+  for (auto &worker : frames[frameIndex]) {
+    if (worker.usedCount > 0) {
+      vkResetCommandPool(lveDevice.device(), worker.commandPool, 0);
+      worker.usedCount = 0;
+    }
+  }
+}
+
+VkCommandBuffer LveCommandRecorder::acquireCommandBuffer(Worker &worker) {
+  if (worker.usedCount == worker.commandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = worker.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    worker.commandBuffers.push_back(commandBuffer);
+  }
+  return worker.commandBuffers[worker.usedCount++];
+}
+
+void LveCommandRecorder::record(
+    VkCommandBuffer primaryCommandBuffer,
+    VkRenderPass renderPass,
+    VkFramebuffer framebuffer,
+    VkExtent2D extent,
+    uint32_t taskCount,
+    const std::function<void(uint32_t worker, VkCommandBuffer commandBuffer)> &record) {
+  taskCount = std::min(taskCount, workerCount);
+  if (taskCount == 0) {
+    return;
+  }
+
+  std::vector<Worker> &workers = frames[currentFrameIndex];
+  recorded.resize(taskCount);
+  threadPool.parallelFor(taskCount, [&](uint32_t task) {
+    VkCommandBuffer commandBuffer = acquireCommandBuffer(workers[task]);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+      throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+
+    // dynamic state is not inherited from the primary
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    record(task, commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record secondary command buffer!");
+    }
+    recorded[task] = commandBuffer;
+  });
+
+  vkCmdExecuteCommands(primaryCommandBuffer, taskCount, recorded.data());
+}
+
+}  // namespace lve
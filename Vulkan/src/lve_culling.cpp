@@ -0,0 +1,191 @@
+#include "lve_culling.hpp"
+
+#if defined(__AVX__)
+#define LVE_CULL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+Frustum Frustum::fromMatrix(const glm::mat4 &matrix) {
+  glm::vec4 row0{matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]};
+  glm::vec4 row1{matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]};
+  glm::vec4 row2{matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]};
+  glm::vec4 row3{matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]};
+
+  Frustum frustum{};
+  frustum.planes[PLANE_LEFT] = row3 + row0;
+  frustum.planes[PLANE_RIGHT] = row3 - row0;
+  frustum.planes[PLANE_BOTTOM] = row3 + row1;
+  frustum.planes[PLANE_TOP] = row3 - row1;
+  frustum.planes[PLANE_NEAR] = row2;
+  frustum.planes[PLANE_FAR] = row3 - row2;
+
+  for (auto &plane : frustum.planes) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.f) {
+      plane /= length;
+    }
+  }
+  return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const {
+  for (const auto &plane : planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LveCullList::clear() {
+  for (auto *values : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ}) {
+    values->clear();
+  }
+}
+
+void LveCullList::reserve(uint32_t capacity) {
+  for (auto *values : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ}) {
+    values->reserve(capacity);
+  }
+}
+
+void LveCullList::add(const glm::mat4 &transform, const glm::vec3 &boxMin, const glm::vec3 &boxMax) {
+  glm::vec3 center = glm::vec3(transform * glm::vec4((boxMin + boxMax) * 0.5f, 1.f));
+  // each world axis extent sums the projections of the transformed half-size axes onto it
+  glm::vec3 halfSize = (boxMax - boxMin) * 0.5f;
+  glm::mat3 absolute{
+      glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2]))};
+  glm::vec3 extent = absolute * halfSize;
+
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extent.x);
+  extentY.push_back(extent.y);
+  extentZ.push_back(extent.z);
+}
+
+// A box is outside when, for some plane, its center lies further behind the plane than the box
+// reaches along the plane normal
+uint32_t LveCullList::cull(const Frustum &frustum, uint32_t *visible) const {
+  const uint32_t count = size();
+  uint32_t visibleCount = 0;
+  uint32_t i = 0;
+
+#if defined(LVE_CULL_AVX)
+  __m256 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT];
+  __m256 planeW[Frustum::PLANE_COUNT];
+  __m256 absX[Frustum::PLANE_COUNT], absY[Frustum::PLANE_COUNT], absZ[Frustum::PLANE_COUNT];
+  for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+    const glm::vec4 &plane = frustum.planes[p];
+    planeX[p] = _mm256_set1_ps(plane.x);
+    planeY[p] = _mm256_set1_ps(plane.y);
+    planeZ[p] = _mm256_set1_ps(plane.z);
+    planeW[p] = _mm256_set1_ps(plane.w);
+    absX[p] = _mm256_set1_ps(glm::abs(plane.x));
+    absY[p] = _mm256_set1_ps(glm::abs(plane.y));
+    absZ[p] = _mm256_set1_ps(glm::abs(plane.z));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= count; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&extentZ[i]);
+    __m256 outside = zero;
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+          _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+      __m256 reach = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_LT_OQ));
+    }
+    // most blocks are usually entirely outside; otherwise every lane is written and only the
+    // visible ones advance the count
+    int insideMask = ~_mm256_movemask_ps(outside) & 0xff;
+    if (insideMask == 0) {
+      continue;
+    }
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      visible[visibleCount] = i + lane;
+      visibleCount += (insideMask >> lane) & 1;
+    }
+  }
+#elif defined(LVE_CULL_SSE)
+  __m128 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT];
+  __m128 planeW[Frustum::PLANE_COUNT];
+  __m128 absX[Frustum::PLANE_COUNT], absY[Frustum::PLANE_COUNT], absZ[Frustum::PLANE_COUNT];
+  for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+    const glm::vec4 &plane = frustum.planes[p];
+    planeX[p] = _mm_set1_ps(plane.x);
+    planeY[p] = _mm_set1_ps(plane.y);
+    planeZ[p] = _mm_set1_ps(plane.z);
+    planeW[p] = _mm_set1_ps(plane.w);
+    absX[p] = _mm_set1_ps(glm::abs(plane.x));
+    absY[p] = _mm_set1_ps(glm::abs(plane.y));
+    absZ[p] = _mm_set1_ps(glm::abs(plane.z));
+  }
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4) {
+    __m128 cx = _mm_loadu_ps(&centerX[i]);
+    __m128 cy = _mm_loadu_ps(&centerY[i]);
+    __m128 cz = _mm_loadu_ps(&centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&extentX[i]);
+    __m128 ey = _mm_loadu_ps(&extentY[i]);
+    __m128 ez = _mm_loadu_ps(&extentZ[i]);
+    __m128 outside = zero;
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+          _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+      __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), zero));
+    }
+    // most blocks are usually entirely outside; otherwise every lane is written and only the
+    // visible ones advance the count
+    int insideMask = ~_mm_movemask_ps(outside) & 0xf;
+    if (insideMask == 0) {
+      continue;
+    }
+    for (uint32_t lane = 0; lane < 4; lane++) {
+      visible[visibleCount] = i + lane;
+      visibleCount += (insideMask >> lane) & 1;
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    bool inside = true;
+    for (const auto &plane : frustum.planes) {
+      float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+      float reach = glm::abs(plane.x) * extentX[i] + glm::abs(plane.y) * extentY[i] + glm::abs(plane.z) * extentZ[i];
+      if (distance + reach < 0.f) {
+        inside = false;
+        break;
+      }
+    }
+    if (inside) {
+      visible[visibleCount++] = i;
+    }
+  }
+  return visibleCount;
+}
+
+bool isConeBackfacing(const glm::vec3 &apex, const glm::vec3 &axis, float cutoff, const glm::vec3 &viewPosition) {
+  if (cutoff > 1.f) {
+    return false;
+  }
+  glm::vec3 toApex = apex - viewPosition;
+  float distance = glm::length(toApex);
+  return distance > 0.f && glm::dot(toApex, axis) >= cutoff * distance;
+}
+
+}  // namespace lve
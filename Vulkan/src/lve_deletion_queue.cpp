@@ -0,0 +1,86 @@
+#include "lve_deletion_queue.hpp"
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+namespace lve {
+
+LveDeletionQueue::LveDeletionQueue(LveDevice &device) : lveDevice{device} {}
+
+LveDeletionQueue::~LveDeletionQueue() {
+  vkDeviceWaitIdle(lveDevice.device());
+  collectAll();
+}
+
+void LveDeletionQueue::enqueue(std::function<void()> destroy) {
+  std::lock_guard<std::mutex> lock{mutex};
+  entries.push_back({frame, std::move(destroy)});
+}
+
+void LveDeletionQueue::destroyBuffer(VkBuffer buffer, LveAllocation allocation) {
+  enqueue([this, buffer, allocation]() mutable { lveDevice.destroyBuffer(buffer, allocation); });
+}
+
+void LveDeletionQueue::destroyImage(VkImage image, LveAllocation allocation) {
+  enqueue([this, image, allocation]() mutable { lveDevice.destroyImage(image, allocation); });
+}
+
+void LveDeletionQueue::destroyImageView(VkImageView imageView) {
+  enqueue([this, imageView]() { vkDestroyImageView(lveDevice.device(), imageView, nullptr); });
+}
+
+void LveDeletionQueue::destroyPipeline(VkPipeline pipeline) {
+  enqueue([this, pipeline]() { vkDestroyPipeline(lveDevice.device(), pipeline, nullptr); });
+}
+
+void LveDeletionQueue::freeDescriptorSets(
+    VkDescriptorPool descriptorPool, std::vector<VkDescriptorSet> descriptorSets) {
+  enqueue([this, descriptorPool, descriptorSets]() {
+    vkFreeDescriptorSets(
+        lveDevice.device(),
+        descriptorPool,
+        static_cast<uint32_t>(descriptorSets.size()),
+        descriptorSets.data());
+  });
+}
+
+void LveDeletionQueue::beginFrame() {
+  std::vector<std::function<void()>> ready;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    frame++;
+    // waiting on this frame slot's fence completed the frame MAX_FRAMES_IN_FLIGHT back and,
+    // through the earlier waits, every frame before it
+    while (!entries.empty() && entries.front().frame + LveSwapChain::MAX_FRAMES_IN_FLIGHT <= frame) {
+      ready.push_back(std::move(entries.front().destroy));
+      entries.pop_front();
+    }
+  }
+  // outside the lock, destructors may queue further deletions
+  for (auto &destroy : ready) {
+    destroy();
+  }
+}
+
+void LveDeletionQueue::collectAll() {
+  while (true) {
+    std::deque<Entry> ready;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (entries.empty()) {
+        return;
+      }
+      ready.swap(entries);
+    }
+    for (auto &entry : ready) {
+      entry.destroy();
+    }
+  }
+}
+
+size_t LveDeletionQueue::getPendingCount() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  return entries.size();
+}
+
+}  // namespace lve
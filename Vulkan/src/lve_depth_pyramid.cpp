@@ -0,0 +1,300 @@
+#include "lve_depth_pyramid.hpp"
+
+#include "lve_deletion_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+struct ReducePushConstantData {
+  glm::ivec2 sourceSize;
+  glm::ivec2 destinationSize;
+};
+
+static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+static uint32_t previousPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result * 2 <= value) {
+    result *= 2;
+  }
+  return result;
+}
+
+LveDepthPyramid::LveDepthPyramid(LveDevice &device, VkExtent2D depthExtent)
+    : lveDevice{device}, depthExtent{depthExtent} {
+  extent = {previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height)};
+  createImage();
+  createDescriptors();
+  createPipeline();
+}
+
+LveDepthPyramid::~LveDepthPyramid() {
+  // the frames in flight may still reduce into or sample the pyramid
+  LveDeletionQueue &deletionQueue = lveDevice.getDeletionQueue();
+  for (VkImageView levelView : levelViews) {
+    deletionQueue.destroyImageView(levelView);
+  }
+  deletionQueue.destroyImageView(imageView);
+  deletionQueue.destroyImage(image, imageAllocation);
+  VkDevice device = lveDevice.device();
+  VkSampler retiredSampler = sampler;
+  VkPipelineLayout retiredLayout = pipelineLayout;
+  deletionQueue.enqueue([device, retiredSampler, retiredLayout]() {
+    vkDestroySampler(device, retiredSampler, nullptr);
+    vkDestroyPipelineLayout(device, retiredLayout, nullptr);
+  });
+  deletionQueue.retire(std::move(reducePipeline));
+  deletionQueue.retire(std::move(descriptorPool));
+  deletionQueue.retire(std::move(setLayout));
+}
+
+void LveDepthPyramid::createImage() {
+  uint32_t levelCount = 1;
+  while ((std::max(extent.width, extent.height) >> levelCount) > 0) {
+    levelCount++;
+  }
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = levelCount;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = VK_FORMAT_R32_SFLOAT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+  lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R32_SFLOAT;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = levelCount;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid image view!");
+  }
+
+  levelViews.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    viewInfo.subresourceRange.baseMipLevel = level;
+    viewInfo.subresourceRange.levelCount = 1;
+    if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create depth pyramid image view!");
+    }
+  }
+
+  // texelFetch ignores filtering, but sampled images still need a sampler
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.minLod = 0.f;
+  samplerInfo.maxLod = static_cast<float>(levelCount);
+  if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid sampler!");
+  }
+
+  // GENERAL once, so levels can be written and read back to back without transitions
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = levelCount;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+  lveDevice.endSingleTimeCommands(commandBuffer);
+}
+
+void LveDepthPyramid::createDescriptors() {
+  const uint32_t levelCount = getLevelCount();
+  setLayout = LveDescriptorSetLayout::Builder(lveDevice)
+      .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+      .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+      .build();
+  descriptorPool = LveDescriptorPool::Builder(lveDevice)
+      .setMaxSets(levelCount)
+      .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levelCount)
+      .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levelCount)
+      .build();
+
+  // set 0 gets its source once build() knows the depth buffer
+  levelSets.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    VkDescriptorImageInfo sourceInfo{sampler, levelViews[level > 0 ? level - 1 : 0], VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+    if (!LveDescriptorWriter(*setLayout, *descriptorPool)
+             .writeImage(0, &sourceInfo)
+             .writeImage(1, &destinationInfo)
+             .build(levelSets[level])) {
+      throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+    }
+  }
+}
+
+void LveDepthPyramid::createPipeline() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ReducePushConstantData);
+
+  VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  reducePipeline = std::make_unique<LvePipeline>(lveDevice, "shaders/bin/depth_reduce.comp.spv", pipelineLayout);
+}
+
+VkDescriptorImageInfo LveDepthPyramid::getDescriptorInfo() const {
+  return {sampler, imageView, VK_IMAGE_LAYOUT_GENERAL};
+}
+
+void LveDepthPyramid::build(
+    VkCommandBuffer commandBuffer,
+    VkImage depthImage,
+    VkImageView depthImageView,
+    VkFormat depthFormat,
+    const glm::mat4 &viewProjection) {
+  // the depth view only changes with the swap chain, which idles the device first, so no frame
+  // in flight can be using set 0 while it is rewritten
+  if (depthImageView != boundDepthView) {
+    VkDescriptorImageInfo sourceInfo{sampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    LveDescriptorWriter(*setLayout, *descriptorPool).writeImage(0, &sourceInfo).overwrite(levelSets[0]);
+    boundDepthView = depthImageView;
+  }
+
+  VkImageMemoryBarrier depthBarrier{};
+  depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.image = depthImage;
+  depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+    depthBarrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  depthBarrier.subresourceRange.baseMipLevel = 0;
+  depthBarrier.subresourceRange.levelCount = 1;
+  depthBarrier.subresourceRange.baseArrayLayer = 0;
+  depthBarrier.subresourceRange.layerCount = 1;
+  depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  // the compute stage in the source scope keeps earlier readers of the pyramid ahead of the writes
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &depthBarrier);
+
+  VkMemoryBarrier levelBarrier{};
+  levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  reducePipeline->bind(commandBuffer);
+  glm::ivec2 sourceSize{static_cast<int>(depthExtent.width), static_cast<int>(depthExtent.height)};
+  for (uint32_t level = 0; level < getLevelCount(); level++) {
+    ReducePushConstantData push{};
+    push.sourceSize = sourceSize;
+    push.destinationSize = glm::ivec2{
+        std::max(static_cast<int>(extent.width >> level), 1), std::max(static_cast<int>(extent.height >> level), 1)};
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelSets[level], 0, nullptr);
+    vkCmdPushConstants(
+        commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstantData), &push);
+    vkCmdDispatch(
+        commandBuffer,
+        (push.destinationSize.x + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+        (push.destinationSize.y + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+        1);
+
+    // also publishes the last level to the culling passes that follow
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &levelBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+    sourceSize = push.destinationSize;
+  }
+
+  // back to the render pass's final layout, and the next pass's depth clear waits for the reads
+  depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthBarrier.srcAccessMask = 0;
+  depthBarrier.dstAccessMask =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &depthBarrier);
+
+  this->viewProjection = viewProjection;
+  valid = true;
+}
+
+}  // namespace lve
@@ -1,5 +1,9 @@
 #include "lve_device.hpp"
 
+#include "lve_deletion_queue.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_upload_context.hpp"
+
 // std headers
 #include <cstring>
 #include <iostream>
@@ -46,6 +50,30 @@ void DestroyDebugUtilsMessengerEXT(
   }
 }
 
+// memory categories follow from how a resource is used, so callers do not have to pass them
+static LveMemoryCategory categorizeBuffer(VkBufferUsageFlags usage) {
+  if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+    return LveMemoryCategory::Geometry;
+  }
+  if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+    return LveMemoryCategory::Uniform;
+  }
+  if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+    return LveMemoryCategory::Staging;
+  }
+  return LveMemoryCategory::Other;
+}
+
+static LveMemoryCategory categorizeImage(VkImageUsageFlags usage) {
+  if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+    return LveMemoryCategory::RenderTarget;
+  }
+  if (usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+    return LveMemoryCategory::Texture;
+  }
+  return LveMemoryCategory::Other;
+}
+
 // class member functions
 LveDevice::LveDevice(LveWindow &window) : window{window} {
   createInstance();
@@ -54,9 +82,18 @@ LveDevice::LveDevice(LveWindow &window) : window{window} {
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  allocator = std::make_unique<LveAllocator>(physicalDevice, device_, memoryBudgetSupported);
+  deletionQueue = std::make_unique<LveDeletionQueue>(*this);
+  uploadContext = std::make_unique<LveUploadContext>(*this);
+  geometryPool = std::make_unique<LveGeometryPool>(*this);
 }
 
 LveDevice::~LveDevice() {
+  // runs pending deletions, which may still free geometry pool ranges
+  deletionQueue.reset();
+  geometryPool.reset();
+  uploadContext.reset();
+  allocator.reset();
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -79,7 +116,8 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.1 for vkGetPhysicalDeviceMemoryProperties2, used to query VK_EXT_memory_budget
+  appInfo.apiVersion = VK_API_VERSION_1_1;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -141,6 +179,9 @@ void LveDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  if (indices.transferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.transferFamily);
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -152,6 +193,9 @@ void LveDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
 
@@ -161,9 +205,26 @@ void LveDevice::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+  // optional extensions are enabled only when present
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  memoryBudgetSupported = properties.apiVersion >= VK_API_VERSION_1_1 &&
+                          isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudgetSupported) {
+    enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+  // GPU generated draws carry their object index in firstInstance and are issued many per call
+  bool drawIndirectCountSupported =
+      isDeviceExtensionAvailable(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) &&
+      supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+  if (drawIndirectCountSupported) {
+    enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    deviceFeatures.multiDrawIndirect = VK_TRUE;
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+  }
+
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -178,8 +239,18 @@ void LveDevice::createLogicalDevice() {
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (drawIndirectCountSupported) {
+    cmdDrawIndexedIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+        vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  if (indices.transferFamilyHasValue) {
+    vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+  } else {
+    transferQueue_ = graphicsQueue_;
+  }
 }
 
 void LveDevice::createCommandPool() {
@@ -318,6 +389,25 @@ bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool LveDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -346,6 +436,25 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // prefer a pure copy engine, then any family that can transfer without graphics
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    const auto &queueFamily = queueFamilies[family];
+    bool transferOnly = queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                        !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+    if (!transferOnly) {
+      continue;
+    }
+    if (!(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+      break;
+    }
+    if (!indices.transferFamilyHasValue) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+    }
+  }
+
   return indices;
 }
 
@@ -378,19 +487,25 @@ SwapChainSupportDetails LveDevice::querySwapChainSupport(VkPhysicalDevice device
 VkFormat LveDevice::findSupportedFormat(
     const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
   for (VkFormat format : candidates) {
-    VkFormatProperties props;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
-
-    if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
-      return format;
-    } else if (
-        tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+    if (isFormatSupported(format, tiling, features)) {
       return format;
     }
   }
   throw std::runtime_error("failed to find supported format!");
 }
 
+bool LveDevice::isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+  if (tiling == VK_IMAGE_TILING_LINEAR) {
+    return (props.linearTilingFeatures & features) == features;
+  } else if (tiling == VK_IMAGE_TILING_OPTIMAL) {
+    return (props.optimalTilingFeatures & features) == features;
+  }
+  return false;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -409,13 +524,24 @@ void LveDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    LveAllocation &bufferAllocation,
+    bool shareWithTransferQueue) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+  uint32_t queueFamilyIndices[2];
+  if (shareWithTransferQueue && hasDedicatedTransferQueue()) {
+    QueueFamilyIndices indices = findPhysicalQueueFamilies();
+    queueFamilyIndices[0] = indices.graphicsFamily;
+    queueFamilyIndices[1] = indices.transferFamily;
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = 2;
+    bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+  }
+
   if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to create vertex buffer!");
   }
@@ -423,16 +549,17 @@ void LveDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferAllocation = allocator->allocate(
+      memRequirements, properties, LveAllocator::ResourceType::Buffer, categorizeBuffer(usage));
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) != VK_SUCCESS) {
+    throw std::runtime_error("failed to bind buffer memory!");
   }
+}
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+void LveDevice::destroyBuffer(VkBuffer buffer, LveAllocation &bufferAllocation) {
+  vkDestroyBuffer(device_, buffer, nullptr);
+  allocator->free(bufferAllocation);
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -461,8 +588,17 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  // wait for this submission only instead of idling the queue
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create single time command fence!");
+  }
+
+  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+  vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+  vkDestroyFence(device_, fence, nullptr);
 
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
@@ -510,7 +646,8 @@ void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    LveAllocation &imageAllocation,
+    VkMemoryPropertyFlags preferredProperties) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -518,18 +655,27 @@ void LveDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
+  if (preferredProperties != 0 &&
+      allocator->hasMemoryType(memRequirements.memoryTypeBits, properties | preferredProperties)) {
+    properties |= preferredProperties;
   }
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  // linear images would have to share the buffer pools' bufferImageGranularity rules
+  imageAllocation = allocator->allocate(
+      memRequirements,
+      properties,
+      imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? LveAllocator::ResourceType::Buffer
+                                                 : LveAllocator::ResourceType::Image,
+      categorizeImage(imageInfo.usage));
+
+  if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void LveDevice::destroyImage(VkImage image, LveAllocation &imageAllocation) {
+  vkDestroyImage(device_, image, nullptr);
+  allocator->free(imageAllocation);
+}
+
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "lve_frame_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace lve {
+
+LveFrameAllocator::LveFrameAllocator(LveDevice &device, VkDeviceSize frameSize, VkBufferUsageFlags usage)
+    : lveDevice{device}, usage{usage} {
+  // both limits are powers of two, so the larger one satisfies either descriptor type
+  const VkPhysicalDeviceLimits &limits = device.properties.limits;
+  alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+  this->frameSize = (frameSize + alignment - 1) & ~(alignment - 1);
+  createBuffer();
+}
+
+void LveFrameAllocator::createBuffer() {
+  // the old buffer's destructor defers destroying it until the other frames in flight are done
+  buffer = std::make_unique<LveBuffer>(
+      lveDevice,
+      frameSize,
+      LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+      usage,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+  if (buffer->map() != VK_SUCCESS) {
+    throw std::runtime_error("failed to map frame allocator buffer!");
+  }
+}
+
+void LveFrameAllocator::beginFrame(int frameIndex) {
+  // grow at least twofold so a steadily growing scene does not replace the buffer every frame
+  if (peakDemand > frameSize) {
+    frameSize = (std::max(peakDemand, frameSize * 2) + alignment - 1) & ~(alignment - 1);
+    createBuffer();
+    generation++;
+    growCount++;
+    peakDemand = 0;
+  }
+
+  // the slot's fence has signaled, so nothing reads its overflow buffers anymore
+  currentFrame = frameIndex;
+  overflow[frameIndex].clear();
+  overflowHead = 0;
+  frameBegin = frameSize * frameIndex;
+  head = frameBegin;
+  demand = 0;
+}
+
+LveFrameAllocator::Allocation LveFrameAllocator::allocate(VkDeviceSize size) {
+  demand += (size + alignment - 1) & ~(alignment - 1);
+  peakDemand = std::max(peakDemand, demand);
+
+  VkDeviceSize offset = head;
+  if (offset + size > frameBegin + frameSize) {
+    return allocateOverflow(size);
+  }
+  head = (offset + size + alignment - 1) & ~(alignment - 1);
+  return {static_cast<char *>(buffer->getMappedMemory()) + offset, static_cast<uint32_t>(offset), buffer->getBuffer()};
+}
+
+LveFrameAllocator::Allocation LveFrameAllocator::allocateOverflow(VkDeviceSize size) {
+  auto &buffers = overflow[currentFrame];
+  if (buffers.empty() || overflowHead + size > buffers.back()->getBufferSize()) {
+    auto overflowBuffer = std::make_unique<LveBuffer>(
+        lveDevice,
+        std::max(size, frameSize),
+        1,
+        usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    if (overflowBuffer->map() != VK_SUCCESS) {
+      throw std::runtime_error("failed to map frame allocator overflow buffer!");
+    }
+    buffers.push_back(std::move(overflowBuffer));
+    overflowHead = 0;
+  }
+
+  LveBuffer &overflowBuffer = *buffers.back();
+  VkDeviceSize offset = overflowHead;
+  overflowHead = (offset + size + alignment - 1) & ~(alignment - 1);
+  return {
+      static_cast<char *>(overflowBuffer.getMappedMemory()) + offset,
+      static_cast<uint32_t>(offset),
+      overflowBuffer.getBuffer()};
+}
+
+void LveFrameAllocator::flush() {
+  if (head > frameBegin) {
+    buffer->flush(head - frameBegin, frameBegin);
+  }
+  for (auto &overflowBuffer : overflow[currentFrame]) {
+    overflowBuffer->flush();
+  }
+}
+
+}  // namespace lve
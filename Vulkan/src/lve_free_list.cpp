@@ -0,0 +1,79 @@
+#include "lve_free_list.hpp"
+
+// std
+#include <algorithm>
+#include <iterator>
+
+namespace lve {
+
+LveFreeList::LveFreeList(uint64_t capacity) : capacity{capacity}, freeSize{capacity} {
+  if (capacity > 0) {
+    freeRanges[0] = capacity;
+  }
+}
+
+bool LveFreeList::allocate(uint64_t size, uint64_t alignment, uint64_t &offset) {
+  auto best = freeRanges.end();
+  uint64_t bestOffset = 0;
+  uint64_t bestLeftover = 0;
+  for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    uint64_t alignedOffset = (it->first + alignment - 1) / alignment * alignment;
+    uint64_t rangeEnd = it->first + it->second;
+    if (alignedOffset + size > rangeEnd) {
+      continue;
+    }
+    uint64_t leftover = it->second - size;
+    if (best == freeRanges.end() || leftover < bestLeftover) {
+      best = it;
+      bestOffset = alignedOffset;
+      bestLeftover = leftover;
+    }
+  }
+  if (best == freeRanges.end()) {
+    return false;
+  }
+
+  // the alignment gap in front stays free and merges back once the neighbour is released
+  uint64_t rangeOffset = best->first;
+  uint64_t rangeEnd = best->first + best->second;
+  freeRanges.erase(best);
+  if (bestOffset > rangeOffset) {
+    freeRanges[rangeOffset] = bestOffset - rangeOffset;
+  }
+  if (bestOffset + size < rangeEnd) {
+    freeRanges[bestOffset + size] = rangeEnd - bestOffset - size;
+  }
+
+  freeSize -= size;
+  offset = bestOffset;
+  return true;
+}
+
+void LveFreeList::free(uint64_t offset, uint64_t size) {
+  freeSize += size;
+
+  auto next = freeRanges.lower_bound(offset);
+  if (next != freeRanges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      size += previous->second;
+      freeRanges.erase(previous);
+    }
+  }
+  if (next != freeRanges.end() && offset + size == next->first) {
+    size += next->second;
+    freeRanges.erase(next);
+  }
+  freeRanges[offset] = size;
+}
+
+uint64_t LveFreeList::getLargestFreeRange() const {
+  uint64_t largest = 0;
+  for (const auto &range : freeRanges) {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+}  // namespace lve
@@ -0,0 +1,289 @@
+#include "lve_geometry_pool.hpp"
+
+#include "lve_deletion_queue.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace lve {
+
+LveGeometryPool::Request LveGeometryPool::Request::indices(VkIndexType indexType, uint32_t count) {
+  uint32_t stride = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  return {VK_BUFFER_USAGE_INDEX_BUFFER_BIT, stride, count};
+}
+
+LveGeometryPool::LveGeometryPool(LveDevice &device) : lveDevice{device} {}
+
+LveGeometryPool::~LveGeometryPool() {
+  for (auto &arena : arenas) {
+    lveDevice.destroyBuffer(arena.buffer, arena.allocation);
+  }
+}
+
+LveGeometryPool::RangeId LveGeometryPool::allocateVertices(
+    uint32_t stride, uint32_t count, const void *data, LveUploadContext &uploadContext) {
+  return allocate(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, stride, count, data, uploadContext);
+}
+
+LveGeometryPool::RangeId LveGeometryPool::allocateIndices(
+    VkIndexType indexType, uint32_t count, const void *data, LveUploadContext &uploadContext) {
+  Request request = Request::indices(indexType, count);
+  return allocate(request.usage, request.stride, count, data, uploadContext);
+}
+
+LveGeometryPool::RangeId LveGeometryPool::allocate(
+    VkBufferUsageFlags usage, uint32_t stride, uint32_t count, const void *data, LveUploadContext &uploadContext) {
+  if (count == 0) {
+    return INVALID_RANGE;
+  }
+
+  uint32_t arenaIndex = findOrCreateArena(usage, stride, count);
+  uint64_t offset;
+  if (!arenas[arenaIndex].freeList.allocate(count, 1, offset)) {
+    // compact in place when the free space would fit the range once packed, otherwise grow
+    const LveFreeList &freeList = arenas[arenaIndex].freeList;
+    uint64_t capacity =
+        getRelocatedCapacity(freeList.getCapacity(), freeList.getCapacity() - freeList.getFreeSize(), count);
+    relocate(arenaIndex, capacity, uploadContext);
+    arenas[arenaIndex].freeList.allocate(count, 1, offset);
+  }
+
+  RangeId id;
+  if (!freeRangeIds.empty()) {
+    id = freeRangeIds.back();
+    freeRangeIds.pop_back();
+  } else {
+    id = static_cast<RangeId>(ranges.size());
+    ranges.emplace_back();
+  }
+  ranges[id] = {arenaIndex, static_cast<uint32_t>(offset), count};
+
+  uploadContext.uploadBuffer(
+      arenas[arenaIndex].buffer,
+      offset * stride,
+      data,
+      static_cast<VkDeviceSize>(count) * stride,
+      true);
+  return id;
+}
+
+void LveGeometryPool::free(RangeId range) {
+  if (range == INVALID_RANGE) {
+    return;
+  }
+  pendingFreeBytes += getSize(range);
+  lveDevice.getDeletionQueue().enqueue([this, range]() { release(range); });
+}
+
+void LveGeometryPool::release(RangeId range) {
+  // looked up now, the range may have been moved by a relocation since it was freed
+  Range &freed = ranges[range];
+  pendingFreeBytes -= getSize(range);
+  arenas[freed.arena].freeList.free(freed.offset, freed.count);
+  freed.count = 0;
+  freeRangeIds.push_back(range);
+}
+
+VkDeviceSize LveGeometryPool::getSize(RangeId range) const {
+  return static_cast<VkDeviceSize>(ranges[range].count) * arenas[ranges[range].arena].stride;
+}
+
+void LveGeometryPool::compact() {
+  for (uint32_t i = 0; i < arenas.size(); i++) {
+    const LveFreeList &freeList = arenas[i].freeList;
+    if (freeList.getFreeSize() > 0 && freeList.getLargestFreeRange() < freeList.getFreeSize() / 2) {
+      relocate(i, freeList.getCapacity(), lveDevice.getUploadContext());
+    }
+  }
+}
+
+LveGeometryPool::Stats LveGeometryPool::getStats() const {
+  Stats stats{};
+  stats.arenaCount = static_cast<uint32_t>(arenas.size());
+  stats.rangeCount = static_cast<uint32_t>(ranges.size() - freeRangeIds.size());
+  for (const auto &arena : arenas) {
+    stats.capacityBytes += arena.freeList.getCapacity() * arena.stride;
+    stats.usedBytes += (arena.freeList.getCapacity() - arena.freeList.getFreeSize()) * arena.stride;
+  }
+  stats.growCount = growCount;
+  stats.compactCount = compactCount;
+  stats.pendingFreeBytes = pendingFreeBytes;
+  return stats;
+}
+
+uint32_t LveGeometryPool::findOrCreateArena(VkBufferUsageFlags usage, uint32_t stride, uint32_t minCount) {
+  for (uint32_t i = 0; i < arenas.size(); i++) {
+    if (arenas[i].usage == usage && arenas[i].stride == stride) {
+      return i;
+    }
+  }
+
+  Arena arena;
+  arena.usage = usage;
+  arena.stride = stride;
+  createArenaBuffer(arena, getInitialCapacity(usage, stride, minCount));
+  arenas.push_back(std::move(arena));
+  return static_cast<uint32_t>(arenas.size() - 1);
+}
+
+uint64_t LveGeometryPool::getInitialCapacity(VkBufferUsageFlags usage, uint32_t stride, uint32_t minCount) {
+  VkDeviceSize defaultSize =
+      usage == VK_BUFFER_USAGE_VERTEX_BUFFER_BIT ? DEFAULT_VERTEX_ARENA_SIZE : DEFAULT_INDEX_ARENA_SIZE;
+  uint64_t capacity = defaultSize / stride;
+  while (capacity < minCount) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+uint64_t LveGeometryPool::getRelocatedCapacity(uint64_t capacity, uint64_t liveCount, uint32_t count) {
+  while (capacity - liveCount < count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+VkDeviceSize LveGeometryPool::estimateGrowth(const std::vector<Request> &requests) const {
+  // replays allocate() on the free space figures of every arena the requests touch
+  struct SimulatedArena {
+    VkBufferUsageFlags usage;
+    uint32_t stride;
+    uint64_t capacity;
+    uint64_t freeCount;
+    // a lower bound once simulated ranges are placed, since they may land in smaller gaps
+    uint64_t largestFreeRange;
+  };
+  std::vector<SimulatedArena> simulated;
+  VkDeviceSize growth = 0;
+
+  for (const Request &request : requests) {
+    if (request.count == 0) {
+      continue;
+    }
+    auto it = std::find_if(simulated.begin(), simulated.end(), [&](const SimulatedArena &arena) {
+      return arena.usage == request.usage && arena.stride == request.stride;
+    });
+    if (it == simulated.end()) {
+      auto existing = std::find_if(arenas.begin(), arenas.end(), [&](const Arena &arena) {
+        return arena.usage == request.usage && arena.stride == request.stride;
+      });
+      if (existing == arenas.end()) {
+        uint64_t capacity = getInitialCapacity(request.usage, request.stride, request.count);
+        growth += capacity * request.stride;
+        simulated.push_back(
+            {request.usage, request.stride, capacity, capacity - request.count, capacity - request.count});
+        continue;
+      }
+      const LveFreeList &freeList = existing->freeList;
+      simulated.push_back(
+          {request.usage,
+           request.stride,
+           freeList.getCapacity(),
+           freeList.getFreeSize(),
+           freeList.getLargestFreeRange()});
+      it = simulated.end() - 1;
+    }
+
+    SimulatedArena &arena = *it;
+    if (request.count <= arena.largestFreeRange) {
+      arena.freeCount -= request.count;
+      arena.largestFreeRange -= request.count;
+      continue;
+    }
+    uint64_t liveCount = arena.capacity - arena.freeCount;
+    arena.capacity = getRelocatedCapacity(arena.capacity, liveCount, request.count);
+    growth += arena.capacity * arena.stride;
+    arena.freeCount = arena.capacity - liveCount - request.count;
+    arena.largestFreeRange = arena.freeCount;
+  }
+  return growth;
+}
+
+void LveGeometryPool::createArenaBuffer(Arena &arena, uint64_t capacity) {
+  // shared with the transfer queue so uploads into one range never need ownership of the
+  // whole buffer while other ranges are being drawn
+  lveDevice.createBuffer(
+      capacity * arena.stride,
+      arena.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      arena.buffer,
+      arena.allocation,
+      true);
+  arena.freeList = LveFreeList{capacity};
+}
+
+void LveGeometryPool::relocate(uint32_t arenaIndex, uint64_t capacity, LveUploadContext &uploadContext) {
+  // queued copies still target the old buffer
+  uploadContext.waitIdle();
+
+  Arena &arena = arenas[arenaIndex];
+  VkBuffer oldBuffer = arena.buffer;
+  LveAllocation oldAllocation = arena.allocation;
+  uint64_t oldCapacity = arena.freeList.getCapacity();
+  createArenaBuffer(arena, capacity);
+
+  std::vector<RangeId> liveRanges;
+  for (RangeId id = 0; id < ranges.size(); id++) {
+    if (ranges[id].arena == arenaIndex && ranges[id].count > 0) {
+      liveRanges.push_back(id);
+    }
+  }
+  std::sort(liveRanges.begin(), liveRanges.end(), [this](RangeId a, RangeId b) {
+    return ranges[a].offset < ranges[b].offset;
+  });
+
+  std::vector<VkBufferCopy> copyRegions;
+  uint64_t packedCount = 0;
+  for (RangeId id : liveRanges) {
+    Range &range = ranges[id];
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = static_cast<VkDeviceSize>(range.offset) * arena.stride;
+    copyRegion.dstOffset = packedCount * arena.stride;
+    copyRegion.size = static_cast<VkDeviceSize>(range.count) * arena.stride;
+    copyRegions.push_back(copyRegion);
+    range.offset = static_cast<uint32_t>(packedCount);
+    packedCount += range.count;
+  }
+
+  if (packedCount > 0) {
+    uint64_t offset;
+    arena.freeList.allocate(packedCount, 1, offset);
+
+    VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+    vkCmdCopyBuffer(
+        commandBuffer,
+        oldBuffer,
+        arena.buffer,
+        static_cast<uint32_t>(copyRegions.size()),
+        copyRegions.data());
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+    lveDevice.endSingleTimeCommands(commandBuffer);
+  }
+
+  // frames in flight may still read the old buffer at the old offsets
+  lveDevice.getDeletionQueue().destroyBuffer(oldBuffer, oldAllocation);
+  generation++;
+  if (capacity > oldCapacity) {
+    growCount++;
+  } else {
+    compactCount++;
+  }
+}
+
+}  // namespace lve
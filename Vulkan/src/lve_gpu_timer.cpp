@@ -0,0 +1,65 @@
+#include "lve_gpu_timer.hpp"
+
+// std
+#include <stdexcept>
+
+namespace lve {
+
+LveGpuTimer::LveGpuTimer(LveDevice &device) : lveDevice{device} {
+  if (lveDevice.properties.limits.timestampComputeAndGraphics != VK_TRUE) {
+    return;
+  }
+  nanosecondsPerTick = lveDevice.properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo queryPoolInfo{};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolInfo.queryCount = 2 * LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+  if (vkCreateQueryPool(lveDevice.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool!");
+  }
+}
+
+LveGpuTimer::~LveGpuTimer() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+  }
+}
+
+void LveGpuTimer::beginFrame(int frameIndex) {
+  if (queryPool == VK_NULL_HANDLE || !written[frameIndex]) {
+    return;
+  }
+  uint64_t ticks[2];
+  VkResult result = vkGetQueryPoolResults(
+      lveDevice.device(),
+      queryPool,
+      2 * frameIndex,
+      2,
+      sizeof(ticks),
+      ticks,
+      sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+  if (result == VK_SUCCESS) {
+    milliseconds = static_cast<double>(ticks[1] - ticks[0]) * nanosecondsPerTick / 1e6;
+  }
+  written[frameIndex] = false;
+}
+
+void LveGpuTimer::begin(VkCommandBuffer commandBuffer, int frameIndex) {
+  if (queryPool == VK_NULL_HANDLE) {
+    return;
+  }
+  vkCmdResetQueryPool(commandBuffer, queryPool, 2 * frameIndex, 2);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * frameIndex);
+}
+
+void LveGpuTimer::end(VkCommandBuffer commandBuffer, int frameIndex) {
+  if (queryPool == VK_NULL_HANDLE) {
+    return;
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * frameIndex + 1);
+  written[frameIndex] = true;
+}
+
+}  // namespace lve
@@ -0,0 +1,112 @@
+#include "lve_mapped_file.hpp"
+
+// std
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lve {
+
+#ifdef _WIN32
+
+LveMappedFile::LveMappedFile(const std::string &filepath) {
+  fileHandle = CreateFileA(
+      filepath.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    fileHandle = nullptr;
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize)) {
+    CloseHandle(fileHandle);
+    throw std::runtime_error("failed to query file size: " + filepath);
+  }
+  size_ = static_cast<size_t>(fileSize.QuadPart);
+
+  // mapping an empty file is an error on win32, an empty view is all we need
+  if (size_ == 0) {
+    return;
+  }
+
+  mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle == nullptr) {
+    CloseHandle(fileHandle);
+    throw std::runtime_error("failed to create file mapping: " + filepath);
+  }
+
+  data_ = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    throw std::runtime_error("failed to map file: " + filepath);
+  }
+}
+
+LveMappedFile::~LveMappedFile() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mappingHandle != nullptr) {
+    CloseHandle(mappingHandle);
+  }
+  if (fileHandle != nullptr) {
+    CloseHandle(fileHandle);
+  }
+}
+
+#else
+
+LveMappedFile::LveMappedFile(const std::string &filepath) {
+  fileDescriptor = open(filepath.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+
+  struct stat fileStat {};
+  if (fstat(fileDescriptor, &fileStat) != 0) {
+    close(fileDescriptor);
+    throw std::runtime_error("failed to query file size: " + filepath);
+  }
+  size_ = static_cast<size_t>(fileStat.st_size);
+
+  if (size_ == 0) {
+    return;
+  }
+
+  void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  if (mapping == MAP_FAILED) {
+    close(fileDescriptor);
+    throw std::runtime_error("failed to map file: " + filepath);
+  }
+  madvise(mapping, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(mapping);
+}
+
+LveMappedFile::~LveMappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  if (fileDescriptor >= 0) {
+    close(fileDescriptor);
+  }
+}
+
+#endif
+
+}  // namespace lve
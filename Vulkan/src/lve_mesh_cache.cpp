@@ -0,0 +1,175 @@
+#include "lve_mesh_cache.hpp"
+
+#include "lve_mapped_file.hpp"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+struct SourceStamp {
+  uint64_t size;
+  int64_t modifiedTime;
+};
+
+bool getSourceStamp(const std::string &sourcePath, SourceStamp &stamp) {
+  std::error_code ec;
+  auto size = std::filesystem::file_size(sourcePath, ec);
+  if (ec) {
+    return false;
+  }
+  auto modifiedTime = std::filesystem::last_write_time(sourcePath, ec);
+  if (ec) {
+    return false;
+  }
+  stamp.size = static_cast<uint64_t>(size);
+  stamp.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+  return true;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+void describeSection(LveMeshCache::Section &section, uint64_t &offset, const std::vector<T> &data) {
+  section.offset = alignUp(offset, 16);
+  section.count = static_cast<uint32_t>(data.size());
+  section.stride = sizeof(T);
+  offset = section.offset + static_cast<uint64_t>(section.count) * section.stride;
+}
+
+template <typename T>
+bool readSection(const LveMappedFile &file, const LveMeshCache::Section &section, std::vector<T> &data) {
+  uint64_t bytes = static_cast<uint64_t>(section.count) * section.stride;
+  if (section.stride != sizeof(T) || section.offset + bytes > file.size()) {
+    return false;
+  }
+  data.resize(section.count);
+  memcpy(data.data(), file.data() + section.offset, bytes);
+  return true;
+}
+
+template <typename T>
+void writeSection(
+    std::ofstream &file, uint64_t &position, const LveMeshCache::Section &section, const std::vector<T> &data) {
+  const char padding[16] = {};
+  file.write(padding, section.offset - position);
+  file.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T));
+  position = section.offset + data.size() * sizeof(T);
+}
+
+}  // namespace
+
+std::string LveMeshCache::cachePathFor(const std::string &sourcePath) {
+  return sourcePath + ".lvemesh";
+}
+
+uint64_t LveMeshCache::optionsKey(const ModelImportOptions &options) {
+  uint32_t weldEpsilonBits;
+  memcpy(&weldEpsilonBits, &options.weldEpsilon, sizeof(weldEpsilonBits));
+  return static_cast<uint64_t>(weldEpsilonBits) | (options.optimizeMesh ? 1ull << 32 : 0) |
+         (options.generateLods ? 1ull << 33 : 0) | (options.generateMeshlets ? 1ull << 34 : 0);
+}
+
+bool LveMeshCache::load(
+    const std::string &sourcePath, const ModelImportOptions &options, LveModel::Builder &builder) {
+  SourceStamp stamp;
+  std::string cachePath = cachePathFor(sourcePath);
+  std::error_code ec;
+  if (!getSourceStamp(sourcePath, stamp) || !std::filesystem::exists(cachePath, ec)) {
+    return false;
+  }
+
+  try {
+    LveMappedFile file{cachePath};
+    if (file.size() < sizeof(Header)) {
+      return false;
+    }
+
+    Header header;
+    memcpy(&header, file.data(), sizeof(Header));
+    if (header.magic != MAGIC || header.version != VERSION || header.sourceSize != stamp.size ||
+        header.sourceModifiedTime != stamp.modifiedTime || header.optionsKey != optionsKey(options)) {
+      return false;
+    }
+
+    LveModel::Builder loaded{};
+    if (!readSection(file, header.sections[SECTION_VERTICES], loaded.vertices) ||
+        !readSection(file, header.sections[SECTION_INDICES], loaded.indices) ||
+        !readSection(file, header.sections[SECTION_LODS], loaded.lods) ||
+        !readSection(file, header.sections[SECTION_MESHLETS], loaded.meshlets)) {
+      return false;
+    }
+
+    builder.vertices = std::move(loaded.vertices);
+    builder.indices = std::move(loaded.indices);
+    builder.lods = std::move(loaded.lods);
+    builder.meshlets = std::move(loaded.meshlets);
+  } catch (const std::exception &) {
+    return false;
+  }
+  return true;
+}
+
+bool LveMeshCache::store(
+    const std::string &sourcePath, const ModelImportOptions &options, const LveModel::Builder &builder) {
+  SourceStamp stamp;
+  if (!getSourceStamp(sourcePath, stamp)) {
+    return false;
+  }
+
+  Header header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.sourceSize = stamp.size;
+  header.sourceModifiedTime = stamp.modifiedTime;
+  header.optionsKey = optionsKey(options);
+
+  uint64_t offset = sizeof(Header);
+  describeSection(header.sections[SECTION_VERTICES], offset, builder.vertices);
+  describeSection(header.sections[SECTION_INDICES], offset, builder.indices);
+  describeSection(header.sections[SECTION_LODS], offset, builder.lods);
+  describeSection(header.sections[SECTION_MESHLETS], offset, builder.meshlets);
+
+  // write to a temporary file first so a crash mid-write never leaves a truncated cache behind
+  std::string cachePath = cachePathFor(sourcePath);
+  std::string tempPath = cachePath + ".tmp";
+  bool written;
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    uint64_t position = sizeof(Header);
+    writeSection(file, position, header.sections[SECTION_VERTICES], builder.vertices);
+    writeSection(file, position, header.sections[SECTION_INDICES], builder.indices);
+    writeSection(file, position, header.sections[SECTION_LODS], builder.lods);
+    writeSection(file, position, header.sections[SECTION_MESHLETS], builder.meshlets);
+    file.close();
+    written = !file.fail();
+  }
+
+  std::error_code ec;
+  if (!written) {
+    // a partial temporary file is never picked up, but would otherwise sit next to the asset
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  std::filesystem::rename(tempPath, cachePath, ec);
+  if (ec) {
+    std::filesystem::remove(tempPath, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace lve
@@ -0,0 +1,320 @@
+#include "lve_mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t INVALID = 0xffffffff;
+
+// Triangles referencing each vertex, stored as one flat array with per-vertex offsets
+struct TriangleAdjacency {
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  TriangleAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount)
+      : counts(vertexCount, 0), offsets(vertexCount + 1, 0), triangles(indices.size()) {
+    for (uint32_t index : indices) {
+      counts[index]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+      offsets[v + 1] = offsets[v] + counts[v];
+    }
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+      triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+};
+
+// FIFO post-transform cache: a vertex hits while fewer than cacheSize misses happened since its
+// own miss. Counting misses instead of shifting a queue keeps this O(1) per index.
+class FifoCache {
+ public:
+  FifoCache(size_t vertexCount, uint32_t cacheSize)
+      : timestamps(vertexCount, 0), time{cacheSize + 1}, cacheSize{cacheSize} {}
+
+  bool access(uint32_t vertex) {
+    if (time - timestamps[vertex] <= cacheSize) {
+      return true;
+    }
+    timestamps[vertex] = time++;
+    return false;
+  }
+
+  void flush() { time += cacheSize + 1; }
+
+ private:
+  std::vector<uint32_t> timestamps;
+  uint32_t time;
+  uint32_t cacheSize;
+};
+
+uint32_t countMisses(const uint32_t *indices, size_t triangleCount, FifoCache &cache) {
+  uint32_t misses = 0;
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    misses += cache.access(indices[i]) ? 0 : 1;
+  }
+  return misses;
+}
+
+}  // namespace
+
+void LveMeshOptimizer::optimizeVertexCache(
+    std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t> *clusters) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+  size_t triangleCount = indices.size() / 3;
+  if (clusters) {
+    clusters->clear();
+  }
+  if (triangleCount == 0) {
+    return;
+  }
+
+  TriangleAdjacency adjacency{indices, vertexCount};
+  std::vector<uint32_t> liveTriangles = adjacency.counts;
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnd;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  uint32_t time = cacheSize + 1;
+  size_t cursor = 0;
+  uint32_t fanning = 0;
+  while (fanning < vertexCount && liveTriangles[fanning] == 0) fanning++;
+  bool newCluster = true;
+
+  while (fanning != INVALID) {
+    if (newCluster && clusters) {
+      clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+    }
+    newCluster = false;
+
+    // emit every remaining triangle around the fanning vertex
+    candidates.clear();
+    for (uint32_t k = adjacency.offsets[fanning]; k < adjacency.offsets[fanning + 1]; k++) {
+      uint32_t triangle = adjacency.triangles[k];
+      if (emitted[triangle]) continue;
+      emitted[triangle] = true;
+
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        uint32_t vertex = indices[triangle * 3 + corner];
+        result.push_back(vertex);
+        deadEnd.push_back(vertex);
+        candidates.push_back(vertex);
+        liveTriangles[vertex]--;
+        if (time - cacheTime[vertex] > cacheSize) {
+          cacheTime[vertex] = time++;
+        }
+      }
+    }
+
+    // prefer the candidate that will still be in the cache after its remaining triangles are
+    // emitted, and of those the one that has been cached the longest
+    uint32_t best = INVALID;
+    int32_t bestPriority = -1;
+    for (uint32_t vertex : candidates) {
+      if (liveTriangles[vertex] == 0) continue;
+      int32_t priority = 0;
+      if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+        priority = static_cast<int32_t>(time - cacheTime[vertex]);
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best = vertex;
+      }
+    }
+
+    if (best == INVALID) {
+      // dead end: fall back to recently emitted vertices, then to input order. Either way the
+      // cache contents are no longer related, which is where a new cluster starts
+      while (!deadEnd.empty()) {
+        uint32_t vertex = deadEnd.back();
+        deadEnd.pop_back();
+        if (liveTriangles[vertex] > 0) {
+          best = vertex;
+          break;
+        }
+      }
+      while (best == INVALID && cursor < vertexCount) {
+        if (liveTriangles[cursor] > 0) {
+          best = static_cast<uint32_t>(cursor);
+        }
+        cursor++;
+      }
+      newCluster = true;
+    }
+    fanning = best;
+  }
+
+  assert(result.size() == indices.size());
+  indices.swap(result);
+}
+
+void LveMeshOptimizer::optimizeOverdraw(
+    std::vector<uint32_t> &indices,
+    const std::vector<uint32_t> &clusters,
+    const float *positions,
+    size_t positionStride,
+    size_t vertexCount,
+    float threshold,
+    uint32_t cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0 || clusters.empty()) {
+    return;
+  }
+
+  auto position = [&](uint32_t vertex) {
+    return reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + vertex * positionStride);
+  };
+
+  // split each hard cluster wherever the ACMR of the piece so far is already at most threshold
+  // times the ACMR of the whole cluster; such splits cost little vertex cache efficiency
+  std::vector<uint32_t> softClusters;
+  FifoCache cache{vertexCount, cacheSize};
+  for (size_t c = 0; c < clusters.size(); c++) {
+    size_t begin = clusters[c];
+    size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+    cache.flush();
+    float clusterAcmr =
+        static_cast<float>(countMisses(&indices[begin * 3], end - begin, cache)) / static_cast<float>(end - begin);
+
+    cache.flush();
+    softClusters.push_back(static_cast<uint32_t>(begin));
+    uint32_t misses = 0;
+    size_t pieceBegin = begin;
+    for (size_t t = begin; t < end; t++) {
+      misses += countMisses(&indices[t * 3], 1, cache);
+      float pieceAcmr = static_cast<float>(misses) / static_cast<float>(t + 1 - pieceBegin);
+      if (t + 1 < end && pieceAcmr <= clusterAcmr * threshold) {
+        softClusters.push_back(static_cast<uint32_t>(t + 1));
+        pieceBegin = t + 1;
+        misses = 0;
+        cache.flush();
+      }
+    }
+  }
+
+  // area weighted centroid and normal per cluster, and the centroid of the whole mesh
+  size_t clusterCount = softClusters.size();
+  std::vector<float> clusterData(clusterCount * 6, 0.f);
+  float meshCentroid[3] = {0.f, 0.f, 0.f};
+  float meshArea = 0.f;
+  for (size_t c = 0; c < clusterCount; c++) {
+    size_t begin = softClusters[c];
+    size_t end = c + 1 < clusterCount ? softClusters[c + 1] : triangleCount;
+    float *centroid = &clusterData[c * 6];
+    float *normal = &clusterData[c * 6 + 3];
+    float clusterArea = 0.f;
+
+    for (size_t t = begin; t < end; t++) {
+      const float *p0 = position(indices[t * 3 + 0]);
+      const float *p1 = position(indices[t * 3 + 1]);
+      const float *p2 = position(indices[t * 3 + 2]);
+      float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+      for (int i = 0; i < 3; i++) {
+        centroid[i] += (p0[i] + p1[i] + p2[i]) * (area / 3.f);
+        normal[i] += n[i];
+      }
+      clusterArea += area;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      meshCentroid[i] += centroid[i];
+      centroid[i] = clusterArea > 0.f ? centroid[i] / clusterArea : 0.f;
+    }
+    meshArea += clusterArea;
+
+    float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    for (int i = 0; i < 3; i++) {
+      normal[i] = length > 0.f ? normal[i] / length : 0.f;
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    meshCentroid[i] = meshArea > 0.f ? meshCentroid[i] / meshArea : 0.f;
+  }
+
+  // clusters facing away from the mesh center are the likely occluders, so they go first
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++) {
+    const float *centroid = &clusterData[c * 6];
+    const float *normal = &clusterData[c * 6 + 3];
+    sortKeys[c] = (centroid[0] - meshCentroid[0]) * normal[0] + (centroid[1] - meshCentroid[1]) * normal[1] +
+                  (centroid[2] - meshCentroid[2]) * normal[2];
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++) order[c] = static_cast<uint32_t>(c);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (uint32_t c : order) {
+    size_t begin = softClusters[c];
+    size_t end = c + 1 < clusterCount ? softClusters[c + 1] : triangleCount;
+    result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+  }
+  indices.swap(result);
+}
+
+size_t LveMeshOptimizer::optimizeVertexFetch(
+    void *vertices, size_t vertexCount, size_t vertexStride, std::vector<uint32_t> &indices) {
+  std::vector<uint32_t> remap(vertexCount, INVALID);
+  uint32_t nextVertex = 0;
+  for (uint32_t &index : indices) {
+    if (remap[index] == INVALID) {
+      remap[index] = nextVertex++;
+    }
+    index = remap[index];
+  }
+
+  std::vector<char> reordered(static_cast<size_t>(nextVertex) * vertexStride);
+  const char *source = static_cast<const char *>(vertices);
+  for (size_t v = 0; v < vertexCount; v++) {
+    if (remap[v] != INVALID) {
+      memcpy(&reordered[remap[v] * vertexStride], source + v * vertexStride, vertexStride);
+    }
+  }
+  memcpy(vertices, reordered.data(), reordered.size());
+  return nextVertex;
+}
+
+VertexCacheStats LveMeshOptimizer::analyzeVertexCache(
+    const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+  VertexCacheStats stats{};
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return stats;
+  }
+
+  FifoCache cache{vertexCount, cacheSize};
+  stats.transformedVertices = countMisses(indices.data(), triangleCount, cache);
+
+  std::vector<bool> referenced(vertexCount, false);
+  size_t uniqueVertices = 0;
+  for (uint32_t index : indices) {
+    if (!referenced[index]) {
+      referenced[index] = true;
+      uniqueVertices++;
+    }
+  }
+
+  stats.acmr = static_cast<float>(stats.transformedVertices) / static_cast<float>(triangleCount);
+  stats.atvr = static_cast<float>(stats.transformedVertices) / static_cast<float>(uniqueVertices);
+  return stats;
+}
+
+}  // namespace lve
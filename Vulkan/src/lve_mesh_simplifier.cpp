@@ -0,0 +1,277 @@
+#include "lve_mesh_simplifier.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace lve {
+
+namespace {
+
+struct Vector3 {
+  double x, y, z;
+};
+
+Vector3 operator-(const Vector3 &a, const Vector3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+double dot(const Vector3 &a, const Vector3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vector3 cross(const Vector3 &a, const Vector3 &b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+// Symmetric 4x4 matrix of the summed squared plane distances, plus the summed plane weights so
+// the error can be turned back into a distance
+struct Quadric {
+  double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd, weight;
+
+  void addPlane(const Vector3 &n, double d, double w) {
+    a2 += w * n.x * n.x;
+    b2 += w * n.y * n.y;
+    c2 += w * n.z * n.z;
+    d2 += w * d * d;
+    ab += w * n.x * n.y;
+    ac += w * n.x * n.z;
+    ad += w * n.x * d;
+    bc += w * n.y * n.z;
+    bd += w * n.y * d;
+    cd += w * n.z * d;
+    weight += w;
+  }
+
+  void add(const Quadric &other) {
+    a2 += other.a2;
+    b2 += other.b2;
+    c2 += other.c2;
+    d2 += other.d2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    bc += other.bc;
+    bd += other.bd;
+    cd += other.cd;
+    weight += other.weight;
+  }
+
+  double evaluate(const Vector3 &p) const {
+    return a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z + d2 +
+           2.0 * (ab * p.x * p.y + ac * p.x * p.z + ad * p.x + bc * p.y * p.z + bd * p.y + cd * p.z);
+  }
+};
+
+struct Collapse {
+  float error;
+  uint32_t source;
+  uint32_t target;
+};
+
+// Maps every vertex to the lowest-numbered vertex with a bitwise identical position
+std::vector<uint32_t> buildPositionRemap(
+    const std::vector<Vector3> &positions, const std::vector<uint32_t> &indices) {
+  std::vector<uint32_t> order(positions.size());
+  for (size_t v = 0; v < order.size(); v++) order[v] = static_cast<uint32_t>(v);
+  auto less = [&](uint32_t a, uint32_t b) {
+    const Vector3 &pa = positions[a];
+    const Vector3 &pb = positions[b];
+    if (pa.x != pb.x) return pa.x < pb.x;
+    if (pa.y != pb.y) return pa.y < pb.y;
+    if (pa.z != pb.z) return pa.z < pb.z;
+    return a < b;
+  };
+  std::sort(order.begin(), order.end(), less);
+
+  std::vector<uint32_t> remap(positions.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    bool samePosition = i > 0 && memcmp(&positions[order[i]], &positions[order[i - 1]], sizeof(Vector3)) == 0;
+    remap[order[i]] = samePosition ? remap[order[i - 1]] : order[i];
+  }
+  return remap;
+}
+
+// Seam vertices and vertices on an edge not shared by exactly two triangles stay in place
+std::vector<bool> findLockedVertices(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &remap) {
+  std::vector<bool> locked(remap.size(), false);
+  std::vector<uint32_t> siblings(remap.size(), 0);
+  for (size_t v = 0; v < remap.size(); v++) {
+    siblings[remap[v]]++;
+  }
+
+  std::vector<uint64_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (int e = 0; e < 3; e++) {
+      uint32_t a = remap[indices[i + e]];
+      uint32_t b = remap[indices[i + (e + 1) % 3]];
+      if (a > b) std::swap(a, b);
+      edges.push_back(static_cast<uint64_t>(a) << 32 | b);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+    while (j < edges.size() && edges[j] == edges[i]) j++;
+    if (j - i != 2) {
+      locked[static_cast<uint32_t>(edges[i] >> 32)] = true;
+      locked[static_cast<uint32_t>(edges[i])] = true;
+    }
+    i = j;
+  }
+
+  for (size_t v = 0; v < remap.size(); v++) {
+    if (siblings[remap[v]] > 1 || locked[remap[v]]) {
+      locked[v] = true;
+    }
+  }
+  return locked;
+}
+
+}  // namespace
+
+std::vector<uint32_t> LveMeshSimplifier::simplify(
+    const std::vector<uint32_t> &indices,
+    const float *positions,
+    size_t positionStride,
+    size_t vertexCount,
+    size_t targetIndexCount,
+    float maxError,
+    float *resultError) {
+  assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+  std::vector<uint32_t> result = indices;
+  if (resultError) {
+    *resultError = 0.f;
+  }
+  if (result.size() <= targetIndexCount) {
+    return result;
+  }
+
+  std::vector<Vector3> points(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    const float *p = reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + v * positionStride);
+    points[v] = {p[0], p[1], p[2]};
+  }
+
+  std::vector<uint32_t> remap = buildPositionRemap(points, indices);
+  std::vector<bool> locked = findLockedVertices(indices, remap);
+
+  // quadrics live on the position-remapped vertex so seam siblings share one
+  std::vector<Quadric> quadrics(vertexCount, Quadric{});
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const Vector3 &p0 = points[indices[i + 0]];
+    Vector3 n = cross(points[indices[i + 1]] - p0, points[indices[i + 2]] - p0);
+    double length = std::sqrt(dot(n, n));
+    if (length == 0.0) continue;
+    n = {n.x / length, n.y / length, n.z / length};
+    double d = -dot(n, p0);
+    for (int corner = 0; corner < 3; corner++) {
+      quadrics[remap[indices[i + corner]]].addPlane(n, d, length * 0.5);
+    }
+  }
+
+  auto collapseError = [&](uint32_t source, uint32_t target) {
+    Quadric q = quadrics[remap[source]];
+    q.add(quadrics[remap[target]]);
+    double error = q.weight > 0.0 ? q.evaluate(points[target]) / q.weight : 0.0;
+    return static_cast<float>(std::sqrt(std::max(error, 0.0)));
+  };
+
+  std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+  std::vector<uint32_t> vertexTriangles;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> collapseTarget(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  float largestError = 0.f;
+
+  // every pass collapses a set of independent edges, cheapest first, then compacts the indices
+  while (result.size() > targetIndexCount) {
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+    for (uint32_t index : result) {
+      triangleOffsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+      triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+    vertexTriangles.resize(result.size());
+    std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < result.size(); i++) {
+      vertexTriangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        uint32_t a = result[i + e];
+        uint32_t b = result[i + (e + 1) % 3];
+        if (!locked[a]) collapses.push_back({collapseError(a, b), a, b});
+        if (!locked[b]) collapses.push_back({collapseError(b, a), b, a});
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+      return a.error < b.error;
+    });
+
+    for (size_t v = 0; v < vertexCount; v++) collapseTarget[v] = static_cast<uint32_t>(v);
+    std::fill(touched.begin(), touched.end(), false);
+    size_t triangleCount = result.size() / 3;
+    size_t targetTriangleCount = targetIndexCount / 3;
+    size_t applied = 0;
+
+    for (const Collapse &collapse : collapses) {
+      if (collapse.error > maxError || triangleCount <= targetTriangleCount) break;
+      uint32_t source = collapse.source;
+      uint32_t target = collapse.target;
+      if (touched[source] || touched[target]) continue;
+
+      // moving source onto target must not flip any triangle that survives the collapse
+      bool flips = false;
+      size_t removed = 0;
+      for (uint32_t k = triangleOffsets[source]; k < triangleOffsets[source + 1] && !flips; k++) {
+        const uint32_t *triangle = &result[vertexTriangles[k] * 3];
+        if (triangle[0] == target || triangle[1] == target || triangle[2] == target) {
+          removed++;
+          continue;
+        }
+        int corner = triangle[0] == source ? 0 : triangle[1] == source ? 1 : 2;
+        const Vector3 &a = points[triangle[(corner + 1) % 3]];
+        const Vector3 &b = points[triangle[(corner + 2) % 3]];
+        Vector3 before = cross(a - points[source], b - points[source]);
+        Vector3 after = cross(a - points[target], b - points[target]);
+        flips = dot(before, after) <= 0.0;
+      }
+      if (flips) continue;
+
+      collapseTarget[source] = target;
+      quadrics[remap[target]].add(quadrics[remap[source]]);
+      for (uint32_t k = triangleOffsets[source]; k < triangleOffsets[source + 1]; k++) {
+        const uint32_t *triangle = &result[vertexTriangles[k] * 3];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+      }
+      triangleCount -= removed;
+      largestError = std::max(largestError, collapse.error);
+      applied++;
+    }
+
+    if (applied == 0) {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      uint32_t a = collapseTarget[result[i + 0]];
+      uint32_t b = collapseTarget[result[i + 1]];
+      uint32_t c = collapseTarget[result[i + 2]];
+      if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) continue;
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  if (resultError) {
+    *resultError = largestError;
+  }
+  return result;
+}
+
+}  // namespace lve
@@ -0,0 +1,128 @@
+#include "lve_meshlet.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lve {
+
+namespace {
+
+void computeBounds(
+    LveMeshlet &meshlet,
+    const uint32_t *indices,
+    const std::vector<uint32_t> &vertices,
+    const float *positions,
+    size_t positionStride) {
+  auto position = [&](uint32_t vertex) {
+    const float *p = reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + vertex * positionStride);
+    return glm::vec3{p[0], p[1], p[2]};
+  };
+
+  glm::vec3 minExtent{std::numeric_limits<float>::max()};
+  glm::vec3 maxExtent{std::numeric_limits<float>::lowest()};
+  for (uint32_t vertex : vertices) {
+    minExtent = glm::min(minExtent, position(vertex));
+    maxExtent = glm::max(maxExtent, position(vertex));
+  }
+  meshlet.center = (minExtent + maxExtent) * 0.5f;
+  meshlet.radius = 0.f;
+  for (uint32_t vertex : vertices) {
+    meshlet.radius = std::max(meshlet.radius, glm::length(position(vertex) - meshlet.center));
+  }
+
+  // the cone axis is the average triangle normal, its spread the least aligned triangle
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec3> corners;
+  glm::vec3 axis{0.f};
+  for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+    glm::vec3 p0 = position(indices[t * 3 + 0]);
+    glm::vec3 n = glm::cross(position(indices[t * 3 + 1]) - p0, position(indices[t * 3 + 2]) - p0);
+    float length = glm::length(n);
+    if (length == 0.f) continue;
+    normals.push_back(n / length);
+    corners.push_back(p0);
+    axis += normals.back();
+  }
+
+  meshlet.coneAxis = glm::vec3{0.f, 0.f, 1.f};
+  meshlet.coneApex = meshlet.center;
+  meshlet.coneCutoff = 2.f;
+  float axisLength = glm::length(axis);
+  if (normals.empty() || axisLength == 0.f) {
+    return;
+  }
+  axis /= axisLength;
+
+  float minDot = 1.f;
+  for (const auto &n : normals) {
+    minDot = std::min(minDot, glm::dot(n, axis));
+  }
+  // wider than a hemisphere (or close to it) leaves no view direction that sees only back faces
+  if (minDot <= 0.1f) {
+    meshlet.coneAxis = axis;
+    return;
+  }
+
+  // move the apex back along the axis until it lies behind every triangle plane
+  float maxT = 0.f;
+  for (size_t i = 0; i < normals.size(); i++) {
+    float t = glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+    maxT = std::max(maxT, t);
+  }
+
+  meshlet.coneAxis = axis;
+  meshlet.coneApex = meshlet.center - axis * maxT;
+  meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+}
+
+}  // namespace
+
+std::vector<LveMeshlet> LveMeshlet::build(
+    const uint32_t *indices, size_t indexCount, const float *positions, size_t positionStride, size_t vertexCount) {
+  std::vector<LveMeshlet> meshlets;
+  std::vector<uint32_t> lastMeshlet(vertexCount, std::numeric_limits<uint32_t>::max());
+  std::vector<uint32_t> vertices;
+  vertices.reserve(MAX_VERTICES);
+
+  LveMeshlet current{};
+  auto finish = [&]() {
+    if (current.triangleCount == 0) return;
+    current.vertexCount = static_cast<uint32_t>(vertices.size());
+    computeBounds(current, indices + current.firstIndex, vertices, positions, positionStride);
+    meshlets.push_back(current);
+  };
+
+  for (size_t i = 0; i < indexCount; i += 3) {
+    uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+    uint32_t newVertices = 0;
+    for (int corner = 0; corner < 3; corner++) {
+      // a vertex repeated within the triangle only counts once
+      uint32_t vertex = indices[i + corner];
+      bool repeated = (corner > 0 && indices[i] == vertex) || (corner > 1 && indices[i + 1] == vertex);
+      if (lastMeshlet[vertex] != meshletIndex && !repeated) newVertices++;
+    }
+
+    if (vertices.size() + newVertices > MAX_VERTICES || current.triangleCount == MAX_TRIANGLES) {
+      finish();
+      current = LveMeshlet{};
+      current.firstIndex = static_cast<uint32_t>(i);
+      vertices.clear();
+      meshletIndex = static_cast<uint32_t>(meshlets.size());
+    }
+
+    for (int corner = 0; corner < 3; corner++) {
+      uint32_t vertex = indices[i + corner];
+      if (lastMeshlet[vertex] != meshletIndex) {
+        lastMeshlet[vertex] = meshletIndex;
+        vertices.push_back(vertex);
+      }
+    }
+    current.triangleCount++;
+  }
+  finish();
+  return meshlets;
+}
+
+}  // namespace lve
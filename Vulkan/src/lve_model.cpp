@@ -1,75 +1,211 @@
 #include "lve_model.hpp"
 
-#include "lve_utils.hpp"
+#include "lve_mesh_cache.hpp"
+#include "lve_mesh_simplifier.hpp"
+#include "lve_obj_parser.hpp"
+#include "lve_vertex_welder.hpp"
 
 // libs
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <filesystem>
+#include <limits>
 
-namespace std {
-template <>
-struct hash<lve::LveModel::Vertex> {
-  size_t operator()(lve::LveModel::Vertex const &vertex) const {
-    size_t seed = 0;
-    lve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-    return seed;
-  }
-};
-}  // namespace std
+#ifdef _DEBUG
+#include <iostream>
+#endif
 
 namespace lve {
 
-LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder) : lveDevice{device} {
-  createVertexBuffers(builder.vertices);
-  createIndexBuffers(builder.indices);
+namespace {
+
+void computeBounds(const std::vector<LveModel::Vertex> &vertices, glm::vec3 &minExtent, glm::vec3 &maxExtent) {
+  minExtent = glm::vec3{std::numeric_limits<float>::max()};
+  maxExtent = glm::vec3{std::numeric_limits<float>::lowest()};
+  for (const auto &vertex : vertices) {
+    minExtent = glm::min(minExtent, vertex.position);
+    maxExtent = glm::max(maxExtent, vertex.position);
+  }
 }
 
-LveModel::~LveModel() {
+// Greedily cuts the index list at triangle boundaries wherever the indices since the last cut
+// would span more than 16 bits. Fails once more than maxSegments would be needed
+bool buildIndexSegments(
+    const std::vector<uint32_t> &indices,
+    uint32_t vertexCount,
+    uint32_t maxSegments,
+    std::vector<LveModel::IndexSegment> &segments) {
+  segments.clear();
+  if (vertexCount <= 65536) {
+    segments.push_back({0, static_cast<uint32_t>(indices.size()), 0});
+    return true;
+  }
 
+  uint32_t segmentStart = 0;
+  uint32_t low = std::numeric_limits<uint32_t>::max();
+  uint32_t high = 0;
+  for (uint32_t i = 0; i < indices.size(); i += 3) {
+    uint32_t triangleLow = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+    uint32_t triangleHigh = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+    if (triangleHigh - triangleLow > 0xffff) {
+      return false;
+    }
+    if (std::max(high, triangleHigh) - std::min(low, triangleLow) > 0xffff && i > segmentStart) {
+      segments.push_back({segmentStart, i - segmentStart, static_cast<int32_t>(low)});
+      if (segments.size() == maxSegments) {
+        return false;
+      }
+      segmentStart = i;
+      low = triangleLow;
+      high = triangleHigh;
+    } else {
+      low = std::min(low, triangleLow);
+      high = std::max(high, triangleHigh);
+    }
+  }
+  segments.push_back({segmentStart, static_cast<uint32_t>(indices.size()) - segmentStart, static_cast<int32_t>(low)});
+  return true;
 }
 
-std::unique_ptr<LveModel> LveModel::createModelFromFile(LveDevice &device, const std::string &filepath) {
+}  // namespace
+
+LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder)
+    : LveModel{device, builder, device.getUploadContext()} {
+  LveUploadContext &uploadContext = lveDevice.getUploadContext();
+  uploadContext.wait(uploadContext.flush());
+}
+
+LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder, LveUploadContext &uploadContext)
+    : lveDevice{device} {
+  static std::atomic<uint32_t> nextId{0};
+  id = nextId++;
+  createVertexBuffers(builder, uploadContext);
+  createIndexBuffers(builder.indices, static_cast<uint32_t>(builder.vertices.size()), uploadContext);
+  initializeFromBuilder(builder);
+}
+
+void LveModel::initializeFromBuilder(const LveModel::Builder &builder) {
+  computeBoundingVolumes(builder.vertices);
+
+  lods = builder.lods;
+  meshlets = builder.meshlets;
+  if (lods.empty() && hasIndexBuffer) {
+    lods.push_back({0, indexCount, 0.f});
+  }
+}
+
+LveModel::~LveModel() {
+  LveGeometryPool &geometryPool = lveDevice.getGeometryPool();
+  geometryPool.free(vertexRange);
+  geometryPool.free(positionRange);
+  geometryPool.free(indexRange);
+}
+
+std::unique_ptr<LveModel> LveModel::createModelFromFile(
+    LveDevice &device, const std::string &filepath, const ModelImportOptions &options) {
   Builder builder{};
-  builder.loadModel(filepath);
+  builder.loadModel(filepath, options);
+
+#ifdef _DEBUG
+  const ModelImportStats &stats = builder.importStats;
+  std::cout << "model " << filepath << ": " << builder.vertices.size() << " vertices, "
+            << builder.indices.size() / 3 << " triangles, " << stats.seconds * 1000.0 << " ms ("
+            << (stats.fromCache ? "cache" : options.useNativeObjParser ? "native parser" : "tinyobj")
+            << ", " << stats.bytesPerSecond() / (1024.0 * 1024.0) << " MB/s)" << std::endl;
+  if (stats.optimized) {
+    std::cout << "  vertex cache: ACMR " << stats.cacheBefore.acmr << " -> " << stats.cacheAfter.acmr
+              << ", ATVR " << stats.cacheBefore.atvr << " -> " << stats.cacheAfter.atvr << std::endl;
+  }
+#endif
+
   return std::make_unique<LveModel>(device, builder);
 }
 
-void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
+std::vector<LveGeometryPool::Request> LveModel::getGeometryRequests(const Builder &builder) {
+  uint32_t vertexCount = static_cast<uint32_t>(builder.vertices.size());
+  std::vector<LveGeometryPool::Request> requests;
+  if (builder.vertexFormat == VertexFormat::Compact) {
+    requests.push_back(LveGeometryPool::Request::vertices(sizeof(LveCompactVertex), vertexCount));
+    if (builder.positionStream) {
+      requests.push_back(LveGeometryPool::Request::vertices(sizeof(LveCompactVertex::position), vertexCount));
+    }
+  } else {
+    requests.push_back(LveGeometryPool::Request::vertices(sizeof(Vertex), vertexCount));
+    if (builder.positionStream) {
+      requests.push_back(LveGeometryPool::Request::vertices(sizeof(glm::vec3), vertexCount));
+    }
+  }
+
+  if (!builder.indices.empty()) {
+    std::vector<IndexSegment> segments;
+    VkIndexType indexType = buildIndexSegments(builder.indices, vertexCount, MAX_INDEX_SEGMENTS, segments)
+                                ? VK_INDEX_TYPE_UINT16
+                                : VK_INDEX_TYPE_UINT32;
+    requests.push_back(LveGeometryPool::Request::indices(indexType, static_cast<uint32_t>(builder.indices.size())));
+  }
+  return requests;
+}
+
+void LveModel::createVertexBuffers(
+    const LveModel::Builder &builder,
+    LveUploadContext &uploadContext) {
+  const std::vector<Vertex> &vertices = builder.vertices;
   vertexCount = static_cast<uint32_t>(vertices.size());
   assert(vertexCount >= 3 && "Vertex count must be at least 3");
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-  uint32_t vertexSize = sizeof(vertices[0]);
+  vertexFormat = builder.vertexFormat;
 
-  LveBuffer stagingBuffer {
-    lveDevice,
-    vertexSize,
-    vertexCount,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+  if (vertexFormat == VertexFormat::Compact) {
+    LveVertexQuantizer quantizer = builder.createQuantizer();
+    dequantizationMatrix = quantizer.getDequantizationMatrix();
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)vertices.data());
+    std::vector<LveCompactVertex> compactVertices(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      const Vertex &vertex = vertices[i];
+      compactVertices[i] = quantizer.encode(vertex.position, vertex.color, vertex.normal, vertex.uv);
+    }
+    vertexRange = lveDevice.getGeometryPool().allocateVertices(
+        sizeof(LveCompactVertex), vertexCount, compactVertices.data(), uploadContext);
+    if (!builder.positionStream) {
+      return;
+    }
 
-  vertexBuffer = std::make_unique<LveBuffer>(
-      lveDevice,
-      vertexSize,
-      vertexCount,
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
+    // the position stream repeats the exact encoded values, so both streams rasterize the same depth
+    std::vector<uint16_t> compactPositions(vertexCount * 4);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      std::copy(compactVertices[i].position, compactVertices[i].position + 4, &compactPositions[i * 4]);
+    }
+    positionRange = lveDevice.getGeometryPool().allocateVertices(
+        sizeof(LveCompactVertex::position), vertexCount, compactPositions.data(), uploadContext);
+    return;
+  }
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+  dequantizationMatrix = glm::mat4{1.f};
+  vertexRange = lveDevice.getGeometryPool().allocateVertices(
+      sizeof(vertices[0]), vertexCount, vertices.data(), uploadContext);
+  if (!builder.positionStream) {
+    return;
+  }
+
+  std::vector<glm::vec3> positions(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    positions[i] = vertices[i].position;
+  }
+  positionRange = lveDevice.getGeometryPool().allocateVertices(
+      sizeof(positions[0]), vertexCount, positions.data(), uploadContext);
 }
 
-void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
+void LveModel::createIndexBuffers(
+    const std::vector<uint32_t> &indices,
+    uint32_t vertexCount,
+    LveUploadContext &uploadContext) {
   indexCount = static_cast<uint32_t>(indices.size());
   hasIndexBuffer = indexCount > 0;
 
@@ -77,61 +213,221 @@ void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
     return;
   }
 
-  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-  uint32_t indexSize = sizeof(indices[0]);
+  if (buildIndexSegments(indices, vertexCount, MAX_INDEX_SEGMENTS, indexSegments)) {
+    indexType = VK_INDEX_TYPE_UINT16;
+    std::vector<uint16_t> shortIndices(indexCount);
+    for (const auto &segment : indexSegments) {
+      for (uint32_t i = segment.firstIndex; i < segment.firstIndex + segment.indexCount; i++) {
+        shortIndices[i] = static_cast<uint16_t>(indices[i] - static_cast<uint32_t>(segment.vertexOffset));
+      }
+    }
+    indexRange = lveDevice.getGeometryPool().allocateIndices(
+        VK_INDEX_TYPE_UINT16, indexCount, shortIndices.data(), uploadContext);
+    return;
+  }
+
+  indexType = VK_INDEX_TYPE_UINT32;
+  indexSegments.assign(1, IndexSegment{0, indexCount, 0});
+  indexRange = lveDevice.getGeometryPool().allocateIndices(
+      VK_INDEX_TYPE_UINT32, indexCount, indices.data(), uploadContext);
+}
 
-  LveBuffer stagingBuffer(
-      lveDevice,
-      indexSize,
-      indexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-  );
+VkDeviceSize LveModel::getIndexBytesSaved() const {
+  return indexType == VK_INDEX_TYPE_UINT16 ? static_cast<VkDeviceSize>(indexCount) * 2 : 0;
+}
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)indices.data());
+VkDeviceSize LveModel::getMemorySize() const {
+  const LveGeometryPool &geometryPool = lveDevice.getGeometryPool();
+  VkDeviceSize size = geometryPool.getSize(vertexRange);
+  if (hasPositionStream()) {
+    size += geometryPool.getSize(positionRange);
+  }
+  if (hasIndexBuffer) {
+    size += geometryPool.getSize(indexRange);
+  }
+  return size;
+}
 
-  indexBuffer = std::make_unique<LveBuffer>(
-      lveDevice,
-      indexSize,
-      indexCount,
-      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
+void LveModel::computeBoundingVolumes(const std::vector<Vertex> &vertices) {
+  computeBounds(vertices, boundingBoxMin, boundingBoxMax);
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+  boundingCenter = (boundingBoxMin + boundingBoxMax) * 0.5f;
+  boundingRadius = 0.f;
+  for (const auto &vertex : vertices) {
+    boundingRadius = std::max(boundingRadius, glm::length(vertex.position - boundingCenter));
+  }
+}
 
+uint32_t LveModel::selectLod(float pixelsPerUnit, float maxPixelError) const {
+  uint32_t lod = 0;
+  while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= maxPixelError) {
+    lod++;
+  }
+  return lod;
 }
 
-void LveModel::draw(VkCommandBuffer commandBuffer) {
+void LveModel::draw(
+    VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance, VertexStream stream) {
   if (hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    drawIndexedRange(commandBuffer, lods[lod].firstIndex, lods[lod].indexCount, instanceCount, firstInstance, stream);
   } else {
-    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    vkCmdDraw(
+        commandBuffer,
+        vertexCount,
+        instanceCount,
+        lveDevice.getGeometryPool().getOffset(getVertexRange(stream)),
+        firstInstance);
+  }
+}
+
+void LveModel::drawIndexedRange(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstIndex,
+    uint32_t indexCount,
+    uint32_t instanceCount,
+    uint32_t firstInstance,
+    VertexStream stream) {
+  // ranges are looked up per draw since the pool moves them when it grows or compacts
+  const LveGeometryPool &geometryPool = lveDevice.getGeometryPool();
+  uint32_t indexBase = geometryPool.getOffset(indexRange);
+  int32_t vertexBase = static_cast<int32_t>(geometryPool.getOffset(getVertexRange(stream)));
+
+  if (indexSegments.size() == 1) {
+    vkCmdDrawIndexed(
+        commandBuffer,
+        indexCount,
+        instanceCount,
+        indexBase + firstIndex,
+        vertexBase + indexSegments[0].vertexOffset,
+        firstInstance);
+    return;
+  }
+
+  uint32_t endIndex = firstIndex + indexCount;
+  for (const auto &segment : indexSegments) {
+    uint32_t begin = std::max(firstIndex, segment.firstIndex);
+    uint32_t end = std::min(endIndex, segment.firstIndex + segment.indexCount);
+    if (begin < end) {
+      vkCmdDrawIndexed(
+          commandBuffer,
+          end - begin,
+          instanceCount,
+          indexBase + begin,
+          vertexBase + segment.vertexOffset,
+          firstInstance);
+    }
+  }
+}
+
+void LveModel::getIndirectCommands(
+    uint32_t lod, std::vector<VkDrawIndexedIndirectCommand> &commands, VertexStream stream) const {
+  const LveGeometryPool &geometryPool = lveDevice.getGeometryPool();
+  uint32_t indexBase = geometryPool.getOffset(indexRange);
+  int32_t vertexBase = static_cast<int32_t>(geometryPool.getOffset(getVertexRange(stream)));
+
+  uint32_t firstIndex = lods[lod].firstIndex;
+  uint32_t endIndex = firstIndex + lods[lod].indexCount;
+  for (const auto &segment : indexSegments) {
+    uint32_t begin = std::max(firstIndex, segment.firstIndex);
+    uint32_t end = std::min(endIndex, segment.firstIndex + segment.indexCount);
+    if (begin < end) {
+      VkDrawIndexedIndirectCommand command{};
+      command.indexCount = end - begin;
+      command.instanceCount = 1;
+      command.firstIndex = indexBase + begin;
+      command.vertexOffset = vertexBase + segment.vertexOffset;
+      command.firstInstance = 0;
+      commands.push_back(command);
+    }
+  }
+}
+
+uint32_t LveModel::drawMeshlets(
+    VkCommandBuffer commandBuffer, const Frustum &frustum, const glm::vec3 &viewPosition, VertexStream stream) {
+  uint32_t visibleCount = 0;
+  uint32_t runFirstIndex = 0;
+  uint32_t runIndexCount = 0;
+  for (const auto &meshlet : meshlets) {
+    if (!meshlet.isVisible(frustum, viewPosition)) {
+      continue;
+    }
+    visibleCount++;
+
+    if (runIndexCount > 0 && runFirstIndex + runIndexCount == meshlet.firstIndex) {
+      runIndexCount += meshlet.triangleCount * 3;
+      continue;
+    }
+    if (runIndexCount > 0) {
+      drawIndexedRange(commandBuffer, runFirstIndex, runIndexCount, 1, 0, stream);
+    }
+    runFirstIndex = meshlet.firstIndex;
+    runIndexCount = meshlet.triangleCount * 3;
+  }
+  if (runIndexCount > 0) {
+    drawIndexedRange(commandBuffer, runFirstIndex, runIndexCount, 1, 0, stream);
   }
+  return visibleCount;
 }
 
-void LveModel::bind(VkCommandBuffer commandBuffer) {
-  VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+void LveModel::bind(VkCommandBuffer commandBuffer, VertexStream stream) {
+  VkBuffer buffers[] = {getVertexBuffer(stream)};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
   if (hasIndexBuffer) {
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(), 0, indexType);
   }
 }
 
-std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions() {
+LveGeometryPool::RangeId LveModel::getVertexRange(VertexStream stream) const {
+  if (stream == VertexStream::Position) {
+    assert(hasPositionStream() && "Model was imported without a position stream");
+    return positionRange;
+  }
+  return vertexRange;
+}
+
+VkBuffer LveModel::getVertexBuffer(VertexStream stream) const {
+  return lveDevice.getGeometryPool().getBuffer(getVertexRange(stream));
+}
+
+VkBuffer LveModel::getIndexBuffer() const {
+  return hasIndexBuffer ? lveDevice.getGeometryPool().getBuffer(indexRange) : VK_NULL_HANDLE;
+}
+
+std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions(
+    VertexFormat format, VertexStream stream) {
   std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
   bindingDescriptions[0].binding = 0;
-  bindingDescriptions[0].stride = sizeof(Vertex);
+  if (stream == VertexStream::Position) {
+    bindingDescriptions[0].stride =
+        format == VertexFormat::Compact ? sizeof(LveCompactVertex::position) : sizeof(Vertex::position);
+  } else {
+    bindingDescriptions[0].stride = format == VertexFormat::Compact ? sizeof(LveCompactVertex) : sizeof(Vertex);
+  }
   bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
   return bindingDescriptions;
 }
 
-std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions() {
+std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions(
+    VertexFormat format, VertexStream stream) {
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
+  // same formats as the interleaved positions, now at the start of each element
+  if (stream == VertexStream::Position) {
+    attributeDescriptions.push_back(
+        {0, 0, format == VertexFormat::Compact ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT, 0});
+    return attributeDescriptions;
+  }
+
+  if (format == VertexFormat::Compact) {
+    attributeDescriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(LveCompactVertex, position)});
+    attributeDescriptions.push_back({1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(LveCompactVertex, color)});
+    attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(LveCompactVertex, normal)});
+    attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(LveCompactVertex, uv)});
+    return attributeDescriptions;
+  }
+
   attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
   attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
   attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
@@ -140,7 +436,199 @@ std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDes
   return attributeDescriptions;
 }
 
-void LveModel::Builder::loadModel(const std::string &filepath) {
+void LveModel::Builder::loadModel(const std::string &filepath, const ModelImportOptions &options) {
+  auto startTime = std::chrono::high_resolution_clock::now();
+  vertices.clear();
+  indices.clear();
+  lods.clear();
+  meshlets.clear();
+  importStats = ModelImportStats{};
+  vertexFormat = options.vertexFormat;
+  positionStream = options.positionStream;
+
+  std::error_code ec;
+  auto sourceBytes = std::filesystem::file_size(filepath, ec);
+  importStats.sourceBytes = ec ? 0 : static_cast<size_t>(sourceBytes);
+
+  if (options.useMeshCache && LveMeshCache::load(filepath, options, *this)) {
+    importStats.fromCache = true;
+  } else {
+    if (options.useNativeObjParser) {
+      loadObjNative(filepath, options);
+    } else {
+      loadObjTinyObj(filepath, options);
+    }
+
+    if (options.optimizeMesh) {
+      optimize();
+    }
+    if (options.generateMeshlets) {
+      buildMeshlets();
+    }
+    if (options.generateLods) {
+      generateLods();
+    }
+
+    if (options.useMeshCache) {
+      LveMeshCache::store(filepath, options, *this);
+    }
+  }
+
+  if (vertexFormat == VertexFormat::Compact) {
+    importStats.quantizationError = measureQuantizationError();
+
+    float uvRange = 0.f;
+    for (const auto &vertex : vertices) {
+      uvRange = std::max(uvRange, std::max(std::abs(vertex.uv.x), std::abs(vertex.uv.y)));
+    }
+    const LveVertexQuantizer::Error &error = importStats.quantizationError;
+    const LveVertexQuantizer::Error bound = createQuantizer().getErrorBound(uvRange);
+    assert(
+        error.position <= bound.position && error.normal <= bound.normal && error.uv <= bound.uv &&
+        error.color <= bound.color && "Compact vertex encoding exceeded its error bound");
+    (void)error;
+    (void)bound;
+  }
+
+  importStats.seconds =
+      std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void LveModel::Builder::optimize() {
+  if (indices.empty()) {
+    return;
+  }
+  importStats.cacheBefore = LveMeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+  std::vector<uint32_t> clusters;
+  LveMeshOptimizer::optimizeVertexCache(indices, vertices.size(), LveMeshOptimizer::DEFAULT_CACHE_SIZE, &clusters);
+  LveMeshOptimizer::optimizeOverdraw(
+      indices, clusters, &vertices[0].position.x, sizeof(Vertex), vertices.size());
+  LveMeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+  importStats.cacheAfter = LveMeshOptimizer::analyzeVertexCache(indices, vertices.size());
+  importStats.optimized = true;
+}
+
+LveVertexQuantizer LveModel::Builder::createQuantizer() const {
+  glm::vec3 minExtent;
+  glm::vec3 maxExtent;
+  computeBounds(vertices, minExtent, maxExtent);
+  return LveVertexQuantizer{minExtent, maxExtent};
+}
+
+LveVertexQuantizer::Error LveModel::Builder::measureQuantizationError() const {
+  LveVertexQuantizer quantizer = createQuantizer();
+  LveVertexQuantizer::Error error{};
+  for (const auto &vertex : vertices) {
+    glm::vec3 position, color, normal;
+    glm::vec2 uv;
+    quantizer.decode(quantizer.encode(vertex.position, vertex.color, vertex.normal, vertex.uv), position, color, normal, uv);
+
+    error.position = std::max(error.position, glm::length(position - vertex.position));
+    float normalLength = glm::length(vertex.normal);
+    if (normalLength > 0.f) {
+      float cosine = std::clamp(glm::dot(normal, vertex.normal / normalLength), -1.f, 1.f);
+      error.normal = std::max(error.normal, std::acos(cosine));
+    }
+    error.uv = std::max(error.uv, std::max(std::abs(uv.x - vertex.uv.x), std::abs(uv.y - vertex.uv.y)));
+    for (int i = 0; i < 3; i++) {
+      error.color = std::max(error.color, std::abs(color[i] - std::clamp(vertex.color[i], 0.f, 1.f)));
+    }
+  }
+  return error;
+}
+
+void LveModel::Builder::buildMeshlets() {
+  size_t indexCount = lods.empty() ? indices.size() : lods[0].indexCount;
+  if (indexCount == 0) {
+    meshlets.clear();
+    return;
+  }
+  meshlets = LveMeshlet::build(indices.data(), indexCount, &vertices[0].position.x, sizeof(Vertex), vertices.size());
+}
+
+void LveModel::Builder::generateLods() {
+  static constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+  lods.clear();
+  if (indices.empty()) {
+    return;
+  }
+  lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.f});
+
+  // every level is simplified from the full mesh so its error is measured against the original
+  const std::vector<uint32_t> source = indices;
+  while (lods.size() < MAX_LOD_COUNT) {
+    size_t targetIndexCount = lods.back().indexCount / 2;
+    targetIndexCount -= targetIndexCount % 3;
+    if (targetIndexCount < MIN_LOD_TRIANGLES * 3) {
+      break;
+    }
+
+    float error = 0.f;
+    std::vector<uint32_t> lodIndices = LveMeshSimplifier::simplify(
+        source,
+        &vertices[0].position.x,
+        sizeof(Vertex),
+        vertices.size(),
+        targetIndexCount,
+        std::numeric_limits<float>::max(),
+        &error);
+
+    // locked borders and seams can stall the reduction; a level barely smaller is not worth keeping
+    if (lodIndices.size() * 10 > static_cast<size_t>(lods.back().indexCount) * 9) {
+      break;
+    }
+
+    LveMeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+    lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error});
+    indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+  }
+}
+
+void LveModel::Builder::loadObjNative(const std::string &filepath, const ModelImportOptions &options) {
+  LveObjParser::Result obj = LveObjParser::parse(filepath);
+
+  LveVertexWelder welder{vertices, obj.indices.size(), options.weldEpsilon};
+  indices.reserve(obj.indices.size());
+  for (const auto &index : obj.indices) {
+    Vertex vertex{};
+
+    if (index.position >= 0) {
+      vertex.position = {
+          obj.positions[3 * index.position + 0],
+          obj.positions[3 * index.position + 1],
+          obj.positions[3 * index.position + 2],
+      };
+
+      vertex.color = {
+          obj.colors[3 * index.position + 0],
+          obj.colors[3 * index.position + 1],
+          obj.colors[3 * index.position + 2],
+      };
+    }
+
+    if (index.normal >= 0) {
+      vertex.normal = {
+          obj.normals[3 * index.normal + 0],
+          obj.normals[3 * index.normal + 1],
+          obj.normals[3 * index.normal + 2],
+      };
+    }
+
+    if (index.texcoord >= 0) {
+      vertex.uv = {
+          obj.texcoords[2 * index.texcoord + 0],
+          obj.texcoords[2 * index.texcoord + 1],
+      };
+    }
+
+    indices.push_back(welder.weld(vertex));
+  }
+}
+
+void LveModel::Builder::loadObjTinyObj(const std::string &filepath, const ModelImportOptions &options) {
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
@@ -150,10 +638,13 @@ void LveModel::Builder::loadModel(const std::string &filepath) {
     throw std::runtime_error(warn + err);
   }
 
-  vertices.clear();
-  indices.clear();
+  size_t indexCount = 0;
+  for (const auto &shape : shapes) {
+    indexCount += shape.mesh.indices.size();
+  }
 
-  std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+  LveVertexWelder welder{vertices, indexCount, options.weldEpsilon};
+  indices.reserve(indexCount);
   for (const auto &shape : shapes) {
     for (const auto &index : shape.mesh.indices) {
       Vertex vertex{};
@@ -187,11 +678,7 @@ void LveModel::Builder::loadModel(const std::string &filepath) {
         };
       }
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
-      indices.push_back(uniqueVertices[vertex]);
+      indices.push_back(welder.weld(vertex));
     }
   }
 }
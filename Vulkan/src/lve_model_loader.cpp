@@ -0,0 +1,172 @@
+#include "lve_model_loader.hpp"
+
+#ifdef _DEBUG
+#include <iostream>
+#endif
+
+namespace lve {
+
+LveModelLoader::LveModelLoader(LveDevice &device, uint32_t threadCount)
+    : lveDevice{device}, workers{threadCount} {}
+
+LveModelLoader::~LveModelLoader() {
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    parsedCondition.wait(lock, [this]() { return parsingCount == 0; });
+  }
+  retireUploads(true);
+}
+
+std::shared_ptr<LveModelHandle> LveModelLoader::load(
+    const std::string &filepath, const ModelImportOptions &options) {
+  auto handle = std::make_shared<LveModelHandle>(filepath);
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    parsingCount++;
+  }
+
+  workers.submit([this, handle, options]() {
+    ParsedModel parsed{handle, std::make_unique<LveModel::Builder>(), {}};
+    try {
+      parsed.builder->loadModel(handle->getFilepath(), options);
+      parsed.geometry = LveModel::getGeometryRequests(*parsed.builder);
+      for (const auto &request : parsed.geometry) {
+        parsed.bytes += request.getSize();
+      }
+    } catch (const std::exception &e) {
+      parsed.error = e.what();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      parsedModels.push_back(std::move(parsed));
+      parsingCount--;
+    }
+    parsedCondition.notify_all();
+  });
+  return handle;
+}
+
+void LveModelLoader::update() {
+  retireUploads(false);
+  submitUploads(true);
+}
+
+void LveModelLoader::waitIdle() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      parsedCondition.wait(lock, [this]() { return parsingCount == 0 || !parsedModels.empty(); });
+      if (parsingCount == 0 && parsedModels.empty() && uploadsInFlight.empty()) {
+        return;
+      }
+    }
+    // nothing evicts while we block here, so the memory budget cannot be honoured
+    submitUploads(false);
+    retireUploads(true);
+  }
+}
+
+uint32_t LveModelLoader::getPendingCount() {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t pending = parsingCount + static_cast<uint32_t>(parsedModels.size());
+  for (const auto &batch : uploadsInFlight) {
+    pending += static_cast<uint32_t>(batch.handles.size());
+  }
+  return pending;
+}
+
+void LveModelLoader::submitUploads(bool enforceMemoryBudget) {
+  std::vector<ParsedModel> ready;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    VkDeviceSize bytes = 0;
+    // every range the batch places so far, since earlier models decide which arenas have to grow
+    std::vector<LveGeometryPool::Request> batchGeometry;
+    deferredBytes = 0;
+    while (!parsedModels.empty() && (ready.empty() || bytes < uploadBudget)) {
+      const ParsedModel &next = parsedModels.front();
+      if (enforceMemoryBudget && next.error.empty()) {
+        size_t batchRequestCount = batchGeometry.size();
+        batchGeometry.insert(batchGeometry.end(), next.geometry.begin(), next.geometry.end());
+        if (!fitsMemoryBudget(batchGeometry)) {
+          // back off until evictions make room instead of running the device out of memory
+          batchGeometry.resize(batchRequestCount);
+          for (const auto &parsed : parsedModels) {
+            deferredBytes += parsed.bytes;
+          }
+          budgetDeferralCount++;
+          break;
+        }
+      }
+      bytes += next.bytes;
+      ready.push_back(std::move(parsedModels.front()));
+      parsedModels.pop_front();
+    }
+  }
+
+  UploadBatch batch{};
+  LveUploadContext &uploadContext = lveDevice.getUploadContext();
+  for (auto &parsed : ready) {
+    if (!parsed.error.empty()) {
+      parsed.handle->error = parsed.error;
+      parsed.handle->state.store(LveModelHandle::State::Failed, std::memory_order_release);
+#ifdef _DEBUG
+      std::cerr << "failed to load model " << parsed.handle->getFilepath() << ": " << parsed.error << std::endl;
+#endif
+      continue;
+    }
+
+    batch.models.push_back(std::make_shared<LveModel>(lveDevice, *parsed.builder, uploadContext));
+    batch.handles.push_back(parsed.handle);
+  }
+
+  if (batch.models.empty()) {
+    return;
+  }
+  batch.uploadToken = uploadContext.flush();
+
+  std::lock_guard<std::mutex> lock{mutex};
+  uploadsInFlight.push_back(std::move(batch));
+}
+
+void LveModelLoader::retireUploads(bool wait) {
+  LveUploadContext &uploadContext = lveDevice.getUploadContext();
+  std::vector<UploadBatch> finished;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto it = uploadsInFlight.begin(); it != uploadsInFlight.end();) {
+      if (wait) {
+        uploadContext.wait(it->uploadToken);
+      }
+      if (uploadContext.isComplete(it->uploadToken)) {
+        finished.push_back(std::move(*it));
+        it = uploadsInFlight.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  for (auto &batch : finished) {
+    for (size_t i = 0; i < batch.handles.size(); i++) {
+      LveModelHandle &handle = *batch.handles[i];
+      handle.model = std::move(batch.models[i]);
+      handle.state.store(LveModelHandle::State::Resident, std::memory_order_release);
+#ifdef _DEBUG
+      auto elapsed = std::chrono::steady_clock::now() - handle.requestTime;
+      std::cout << "model " << handle.getFilepath() << " resident after "
+                << std::chrono::duration<double, std::milli>(elapsed).count() << " ms" << std::endl;
+#endif
+    }
+  }
+}
+
+bool LveModelLoader::fitsMemoryBudget(const std::vector<LveGeometryPool::Request> &requests) {
+  // free space in the arenas the ranges land in is reused first; only growing or compacting an
+  // arena allocates device memory, and then a whole new buffer of it
+  VkDeviceSize growth = lveDevice.getGeometryPool().estimateGrowth(requests);
+  return growth == 0 || lveDevice.getAllocator().isWithinSoftBudget(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, growth);
+}
+
+}  // namespace lve
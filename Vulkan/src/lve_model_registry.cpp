@@ -0,0 +1,99 @@
+#include "lve_model_registry.hpp"
+
+#include "lve_geometry_pool.hpp"
+#include "lve_mesh_cache.hpp"
+
+// std
+#include <algorithm>
+#include <filesystem>
+
+namespace lve {
+
+LveModelRegistry::LveModelRegistry(LveModelLoader &loader, VkDeviceSize memoryBudget)
+    : loader{loader}, memoryBudget{memoryBudget} {}
+
+std::string LveModelRegistry::makeKey(const std::string &filepath, const ModelImportOptions &options) {
+  std::error_code ec;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(filepath, ec);
+  std::string path = ec ? filepath : canonical.generic_string();
+  // the mesh cache key covers the geometry; the GPU layout decides which buffers get uploaded
+  return path + '|' + std::to_string(LveMeshCache::optionsKey(options)) + '|' +
+         std::to_string(static_cast<int>(options.vertexFormat)) + (options.positionStream ? "|p" : "");
+}
+
+bool LveModelRegistry::isReferenced(const Entry &entry) {
+  // game objects keep the handle while loading and only the model afterwards
+  return entry.handle.use_count() > 1 || (entry.handle->model && entry.handle->model.use_count() > 1);
+}
+
+std::shared_ptr<LveModelHandle> LveModelRegistry::acquire(
+    const std::string &filepath, const ModelImportOptions &options) {
+  std::string key = makeKey(filepath, options);
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    stats.hits++;
+    it->second.lastUsedFrame = frame;
+    return it->second.handle;
+  }
+
+  stats.misses++;
+  auto handle = loader.load(filepath, options);
+  entries.emplace(key, Entry{handle, frame});
+  stats.entryCount = static_cast<uint32_t>(entries.size());
+  return handle;
+}
+
+void LveModelRegistry::update() {
+  frame++;
+
+  VkDeviceSize residentBytes = 0;
+  std::vector<std::unordered_map<std::string, Entry>::iterator> evictable;
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (isReferenced(it->second)) {
+      it->second.lastUsedFrame = frame;
+    } else if (it->second.handle->hasFailed()) {
+      it = entries.erase(it);
+      continue;
+    } else if (it->second.handle->isResident()) {
+      evictable.push_back(it);
+    }
+
+    if (it->second.handle->isResident()) {
+      residentBytes += it->second.handle->model->getMemorySize();
+    }
+    ++it;
+  }
+
+  std::sort(evictable.begin(), evictable.end(), [](const auto &a, const auto &b) {
+    return a->second.lastUsedFrame < b->second.lastUsedFrame;
+  });
+
+  // when the loader holds models back for the device memory budget, also free what it needs,
+  // minus what earlier evictions will return once their frames are done
+  VkDeviceSize releasingBytes = loader.getDevice().getGeometryPool().getStats().pendingFreeBytes;
+  VkDeviceSize deferredBytes = loader.getDeferredBytes();
+  VkDeviceSize neededBytes = deferredBytes > releasingBytes ? deferredBytes - releasingBytes : 0;
+
+  for (auto it : evictable) {
+    if (residentBytes <= memoryBudget && neededBytes == 0) {
+      break;
+    }
+    VkDeviceSize modelBytes = it->second.handle->model->getMemorySize();
+    residentBytes -= modelBytes;
+    neededBytes -= std::min(neededBytes, modelBytes);
+    stats.evictions++;
+    entries.erase(it);
+  }
+
+  stats.entryCount = static_cast<uint32_t>(entries.size());
+  stats.residentBytes = residentBytes;
+
+  stats.indexBytesSaved = 0;
+  for (const auto &entry : entries) {
+    if (entry.second.handle->isResident()) {
+      stats.indexBytesSaved += entry.second.handle->model->getIndexBytesSaved();
+    }
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,286 @@
+#include "lve_obj_parser.hpp"
+
+#include "lve_mapped_file.hpp"
+
+// std
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+// face corner as written in the file; relative indices are resolved during stitching
+struct RawIndex {
+  int32_t value[3];
+  uint8_t relativeMask;
+};
+
+struct Chunk {
+  const char *begin;
+  const char *end;
+
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<RawIndex> corners;
+  std::vector<size_t> quads;  // first corner of each quad, split once positions are known
+
+  // first global element of each attribute stream, filled in by the prefix sum
+  uint32_t positionBase = 0;
+  uint32_t normalBase = 0;
+  uint32_t texcoordBase = 0;
+  size_t cornerBase = 0;
+  std::string error;
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool isLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+inline const char *skipSpaces(const char *p, const char *end) {
+  while (p < end && isSpace(*p)) p++;
+  return p;
+}
+
+inline bool parseFloat(const char *&p, const char *end, float &value) {
+  p = skipSpaces(p, end);
+  if (p < end && *p == '+') p++;
+  auto result = std::from_chars(p, end, value);
+  if (result.ec != std::errc{}) {
+    return false;
+  }
+  p = result.ptr;
+  return true;
+}
+
+inline bool parseInt(const char *&p, const char *end, int32_t &value) {
+  if (p < end && *p == '+') p++;
+  auto result = std::from_chars(p, end, value);
+  if (result.ec != std::errc{}) {
+    return false;
+  }
+  p = result.ptr;
+  return true;
+}
+
+// Stores a 1-based absolute index as 0-based, or a negative index as an offset from the
+// element count of this chunk at the time the face was read.
+inline void storeIndex(RawIndex &corner, int slot, int32_t fileIndex, size_t localCount) {
+  if (fileIndex > 0) {
+    corner.value[slot] = fileIndex - 1;
+  } else {
+    corner.value[slot] = static_cast<int32_t>(localCount) + fileIndex;
+    corner.relativeMask |= static_cast<uint8_t>(1u << slot);
+  }
+}
+
+bool parseCorner(const char *&p, const char *end, Chunk &chunk, RawIndex &corner) {
+  corner = RawIndex{{-1, -1, -1}, 0};
+  int32_t value;
+  if (!parseInt(p, end, value) || value == 0) {
+    return false;
+  }
+  storeIndex(corner, 0, value, chunk.positions.size() / 3);
+
+  if (p < end && *p == '/') {
+    p++;
+    if (p < end && *p != '/') {
+      if (!parseInt(p, end, value) || value == 0) return false;
+      storeIndex(corner, 1, value, chunk.texcoords.size() / 2);
+    }
+    if (p < end && *p == '/') {
+      p++;
+      if (!parseInt(p, end, value) || value == 0) return false;
+      storeIndex(corner, 2, value, chunk.normals.size() / 3);
+    }
+  }
+  return true;
+}
+
+void parseChunk(Chunk &chunk) {
+  const char *p = chunk.begin;
+  const char *end = chunk.end;
+  std::vector<RawIndex> polygon;
+
+  while (p < end) {
+    p = skipSpaces(p, end);
+    const char *lineStart = p;
+    const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (lineEnd == nullptr) lineEnd = end;
+
+    if (p + 1 < lineEnd && p[0] == 'v' && isSpace(p[1])) {
+      p += 2;
+      float x = 0.f, y = 0.f, z = 0.f;
+      parseFloat(p, lineEnd, x);
+      parseFloat(p, lineEnd, y);
+      parseFloat(p, lineEnd, z);
+      chunk.positions.insert(chunk.positions.end(), {x, y, z});
+
+      float r = 1.f, g = 1.f, b = 1.f;
+      if (!(parseFloat(p, lineEnd, r) && parseFloat(p, lineEnd, g) && parseFloat(p, lineEnd, b))) {
+        r = g = b = 1.f;
+      }
+      chunk.colors.insert(chunk.colors.end(), {r, g, b});
+    } else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+      p += 3;
+      float x = 0.f, y = 0.f, z = 0.f;
+      parseFloat(p, lineEnd, x);
+      parseFloat(p, lineEnd, y);
+      parseFloat(p, lineEnd, z);
+      chunk.normals.insert(chunk.normals.end(), {x, y, z});
+    } else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+      p += 3;
+      float u = 0.f, v = 0.f;
+      parseFloat(p, lineEnd, u);
+      parseFloat(p, lineEnd, v);
+      chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+    } else if (p + 1 < lineEnd && p[0] == 'f' && isSpace(p[1])) {
+      p += 2;
+      polygon.clear();
+      while (true) {
+        p = skipSpaces(p, lineEnd);
+        if (p >= lineEnd || isLineEnd(*p) || *p == '#') break;
+        RawIndex corner;
+        if (!parseCorner(p, lineEnd, chunk, corner)) {
+          chunk.error = "malformed face: " + std::string(lineStart, lineEnd);
+          return;
+        }
+        polygon.push_back(corner);
+      }
+      if (polygon.size() == 4) {
+        chunk.quads.push_back(chunk.corners.size());
+      }
+      for (size_t i = 2; i < polygon.size(); i++) {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i - 1]);
+        chunk.corners.push_back(polygon[i]);
+      }
+    }
+
+    p = lineEnd < end ? lineEnd + 1 : end;
+  }
+}
+
+inline int32_t resolveIndex(const RawIndex &corner, int slot, uint32_t base, uint32_t count) {
+  int32_t value = corner.value[slot];
+  if (corner.relativeMask & (1u << slot)) {
+    value += static_cast<int32_t>(base);
+  }
+  if (value >= static_cast<int32_t>(count)) {
+    return -1;
+  }
+  return value;
+}
+
+// Quads are emitted as the fan [0, 1, 2], [0, 2, 3]; like tinyobj, split along the shorter
+// diagonal instead so both loaders produce the same triangles.
+void splitQuad(LveObjParser::Index *corners, const std::vector<float> &positions) {
+  LveObjParser::Index q[4] = {corners[0], corners[1], corners[2], corners[5]};
+  for (const auto &corner : q) {
+    if (corner.position < 0) return;
+  }
+  auto squaredDistance = [&positions](int32_t a, int32_t b) {
+    float dx = positions[3 * b + 0] - positions[3 * a + 0];
+    float dy = positions[3 * b + 1] - positions[3 * a + 1];
+    float dz = positions[3 * b + 2] - positions[3 * a + 2];
+    return dx * dx + dy * dy + dz * dz;
+  };
+  if (squaredDistance(q[0].position, q[2].position) < squaredDistance(q[1].position, q[3].position)) {
+    return;
+  }
+  corners[0] = q[0];
+  corners[1] = q[1];
+  corners[2] = q[3];
+  corners[3] = q[1];
+  corners[4] = q[2];
+  corners[5] = q[3];
+}
+
+}  // namespace
+
+LveObjParser::Result LveObjParser::parse(
+    const std::string &filepath, LveThreadPool &pool, Stats *stats) {
+  auto startTime = std::chrono::high_resolution_clock::now();
+
+  LveMappedFile file{filepath};
+  const char *data = file.data();
+  const size_t size = file.size();
+
+  // split into line-aligned chunks, a few per thread so uneven chunks still balance
+  size_t targetChunkSize =
+      std::max(MIN_CHUNK_SIZE, size / (static_cast<size_t>(pool.getThreadCount() + 1) * 4));
+  std::vector<Chunk> chunks;
+  const char *cursor = data;
+  const char *fileEnd = data + size;
+  while (cursor < fileEnd) {
+    const char *chunkEnd = cursor + std::min(targetChunkSize, static_cast<size_t>(fileEnd - cursor));
+    if (chunkEnd < fileEnd) {
+      const char *newline = static_cast<const char *>(memchr(chunkEnd, '\n', fileEnd - chunkEnd));
+      chunkEnd = newline != nullptr ? newline + 1 : fileEnd;
+    }
+    Chunk chunk{};
+    chunk.begin = cursor;
+    chunk.end = chunkEnd;
+    chunks.push_back(std::move(chunk));
+    cursor = chunkEnd;
+  }
+
+  pool.parallelFor(static_cast<uint32_t>(chunks.size()), [&chunks](uint32_t i) { parseChunk(chunks[i]); });
+
+  Result result{};
+  size_t positionCount = 0, normalCount = 0, texcoordCount = 0, cornerCount = 0;
+  for (auto &chunk : chunks) {
+    if (!chunk.error.empty()) {
+      throw std::runtime_error(filepath + ": " + chunk.error);
+    }
+    chunk.positionBase = static_cast<uint32_t>(positionCount);
+    chunk.normalBase = static_cast<uint32_t>(normalCount);
+    chunk.texcoordBase = static_cast<uint32_t>(texcoordCount);
+    chunk.cornerBase = cornerCount;
+    positionCount += chunk.positions.size() / 3;
+    normalCount += chunk.normals.size() / 3;
+    texcoordCount += chunk.texcoords.size() / 2;
+    cornerCount += chunk.corners.size();
+  }
+
+  result.positions.resize(positionCount * 3);
+  result.colors.resize(positionCount * 3);
+  result.normals.resize(normalCount * 3);
+  result.texcoords.resize(texcoordCount * 2);
+  result.indices.resize(cornerCount);
+
+  pool.parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i) {
+    const Chunk &chunk = chunks[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(), result.positions.begin() + chunk.positionBase * 3);
+    std::copy(chunk.colors.begin(), chunk.colors.end(), result.colors.begin() + chunk.positionBase * 3);
+    std::copy(chunk.normals.begin(), chunk.normals.end(), result.normals.begin() + chunk.normalBase * 3);
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), result.texcoords.begin() + chunk.texcoordBase * 2);
+
+    for (size_t c = 0; c < chunk.corners.size(); c++) {
+      const RawIndex &corner = chunk.corners[c];
+      Index &index = result.indices[chunk.cornerBase + c];
+      index.position = resolveIndex(corner, 0, chunk.positionBase, static_cast<uint32_t>(positionCount));
+      index.texcoord = resolveIndex(corner, 1, chunk.texcoordBase, static_cast<uint32_t>(texcoordCount));
+      index.normal = resolveIndex(corner, 2, chunk.normalBase, static_cast<uint32_t>(normalCount));
+    }
+
+    for (size_t quad : chunk.quads) {
+      splitQuad(&result.indices[chunk.cornerBase + quad], result.positions);
+    }
+  });
+
+  if (stats != nullptr) {
+    stats->bytes = size;
+    stats->chunkCount = static_cast<uint32_t>(chunks.size());
+    stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+  }
+  return result;
+}
+
+}  // namespace lve
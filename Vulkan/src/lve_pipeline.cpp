@@ -1,5 +1,6 @@
 #include "lve_pipeline.hpp"
 
+#include "lve_deletion_queue.hpp"
 #include "lve_model.hpp"
 
 // std
@@ -19,10 +20,17 @@ LvePipeline::LvePipeline(
   createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
 }
 
+LvePipeline::LvePipeline(LveDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+    : lveDevice{device}, bindPoint{VK_PIPELINE_BIND_POINT_COMPUTE} {
+  createComputePipeline(compFilepath, pipelineLayout);
+}
+
 LvePipeline::~LvePipeline() {
   vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
   vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
-  vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
+  vkDestroyShaderModule(lveDevice.device(), compShaderModule, nullptr);
+  // frames in flight may still have the pipeline bound
+  lveDevice.getDeletionQueue().destroyPipeline(pipeline);
 }
 
 std::vector<char> LvePipeline::readFile(const std::string& filepath) {
@@ -54,10 +62,11 @@ void LvePipeline::createGraphicsPipeline(
       "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
   auto vertCode = readFile(vertFilepath);
-  auto fragCode = readFile(fragFilepath);
-
   createShaderModule(vertCode, &vertShaderModule);
-  createShaderModule(fragCode, &fragShaderModule);
+  if (!fragFilepath.empty()) {
+    auto fragCode = readFile(fragFilepath);
+    createShaderModule(fragCode, &fragShaderModule);
+  }
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -75,8 +84,8 @@ void LvePipeline::createGraphicsPipeline(
   shaderStages[1].pNext = nullptr;
   shaderStages[1].pSpecializationInfo = nullptr;
 
-  auto bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
-  auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+  auto& bindingDescriptions = configInfo.bindingDescriptions;
+  auto& attributeDescriptions = configInfo.attributeDescriptions;
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
   vertexInputInfo.vertexAttributeDescriptionCount =
@@ -87,7 +96,7 @@ void LvePipeline::createGraphicsPipeline(
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -111,11 +120,32 @@ void LvePipeline::createGraphicsPipeline(
           1,
           &pipelineInfo,
           nullptr,
-          &graphicsPipeline) != VK_SUCCESS) {
+          &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
 }
 
+void LvePipeline::createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout) {
+  assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+  auto compCode = readFile(compFilepath);
+  createShaderModule(compCode, &compShaderModule);
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = compShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  if (vkCreateComputePipelines(lveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline");
+  }
+}
+
 void LvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
   VkShaderModuleCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -128,7 +158,7 @@ void LvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModu
 }
 
 void LvePipeline::bind(VkCommandBuffer commandBuffer) {
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+  vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
 }
 
 void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -194,6 +224,9 @@ void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
   configInfo.depthStencilInfo.front = {};  // Optional
   configInfo.depthStencilInfo.back = {};   // Optional
 
+  configInfo.bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+  configInfo.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+
   configInfo.dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
   configInfo.dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
   configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
@@ -202,4 +235,13 @@ void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
   configInfo.dynamicStateInfo.flags = 0;
 }
 
+void LvePipeline::depthOnlyPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+  configInfo.colorBlendAttachment.colorWriteMask = 0;
+}
+
+void LvePipeline::depthEqualPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+  configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+}
+
 }  // namespace lve
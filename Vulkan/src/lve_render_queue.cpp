@@ -0,0 +1,64 @@
+#include "lve_render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lve {
+
+uint64_t LveRenderQueue::makeKey(uint32_t pipeline, float distance, uint32_t modelId, uint32_t lod, uint32_t material) {
+  // the bit pattern of a non-negative float grows with its value; its top 24 bits keep the
+  // exponent and 16 mantissa bits, and bands double in size like the exponent
+  distance = std::max(distance, 0.f);
+  uint32_t distanceBits;
+  std::memcpy(&distanceBits, &distance, sizeof(distanceBits));
+  uint64_t band = static_cast<uint64_t>(std::min(std::max(std::ilogb(std::max(distance, 1.f)), 0), 15));
+
+  return (static_cast<uint64_t>(pipeline & 0xf) << 60) | (band << 56) |
+         (static_cast<uint64_t>(modelId & 0xfffff) << 36) | (static_cast<uint64_t>(lod & 0xf) << 32) |
+         (static_cast<uint64_t>(material & 0xff) << 24) | static_cast<uint64_t>(distanceBits >> 7);
+}
+
+void LveRenderQueue::sort() {
+  const size_t count = entries.size();
+  if (count < 2) {
+    return;
+  }
+  scratch.resize(count);
+
+  // histograms of all eight byte digits in a single pass over the keys
+  uint32_t histograms[8][256] = {};
+  for (const Entry &entry : entries) {
+    for (uint32_t digit = 0; digit < 8; digit++) {
+      histograms[digit][(entry.key >> (digit * 8)) & 0xff]++;
+    }
+  }
+
+  Entry *source = entries.data();
+  Entry *destination = scratch.data();
+  for (uint32_t digit = 0; digit < 8; digit++) {
+    const uint32_t shift = digit * 8;
+    const uint32_t *histogram = histograms[digit];
+    if (histogram[(source[0].key >> shift) & 0xff] == count) {
+      continue;
+    }
+
+    uint32_t offsets[256];
+    uint32_t offset = 0;
+    for (uint32_t value = 0; value < 256; value++) {
+      offsets[value] = offset;
+      offset += histogram[value];
+    }
+    for (size_t i = 0; i < count; i++) {
+      destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+    }
+    std::swap(source, destination);
+  }
+
+  if (source != entries.data()) {
+    entries.swap(scratch);
+  }
+}
+
+}  // namespace lve
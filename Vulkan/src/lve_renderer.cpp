@@ -1,5 +1,7 @@
 #include "lve_renderer.hpp"
 
+#include "lve_deletion_queue.hpp"
+
 // std
 #include <array>
 #include <cassert>
@@ -22,12 +24,13 @@ void LveRenderer::recreateSwapChain() {
     glfwWaitEvents();
   }
   vkDeviceWaitIdle(lveDevice.device());
+  lveDevice.getDeletionQueue().collectAll();
 
   if (lveSwapChain == nullptr) {
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
+    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, depthSampled);
   } else {
     std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain);
+    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain, depthSampled);
 
     if (!oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {
       throw std::runtime_error("Swap chain image(or depth) format has changed!");
@@ -35,6 +38,14 @@ void LveRenderer::recreateSwapChain() {
   }
 }
 
+void LveRenderer::setDepthSampled(bool sampled) {
+  assert(!isFrameStarted && "Can't change the depth buffer while a frame is in progress");
+  if (sampled != depthSampled) {
+    depthSampled = sampled;
+    recreateSwapChain();
+  }
+}
+
 void LveRenderer::createCommandBuffers() {
   commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
 
@@ -71,6 +82,8 @@ VkCommandBuffer LveRenderer::beginFrame() {
   if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
     throw std::runtime_error("failed to acquire swap chain image!");
   }
+  // acquiring waited on this frame slot's fence
+  lveDevice.getDeletionQueue().beginFrame();
 
   isFrameStarted = true;
 
@@ -104,7 +117,7 @@ void LveRenderer::endFrame() {
   currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
   assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
   assert(
       commandBuffer == getCurrentCommandBuffer() &&
@@ -124,7 +137,10 @@ void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  if (contents != VK_SUBPASS_CONTENTS_INLINE) {
+    return;
+  }
 
   VkViewport viewport{};
   viewport.x = 0.0f;
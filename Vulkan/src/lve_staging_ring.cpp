@@ -0,0 +1,41 @@
+#include "lve_staging_ring.hpp"
+
+// std
+#include <cassert>
+
+namespace lve {
+
+LveStagingRing::LveStagingRing(uint64_t size) : size{size} {}
+
+bool LveStagingRing::allocate(uint64_t size, uint64_t alignment, uint64_t &offset) {
+  size = (size + alignment - 1) & ~(alignment - 1);
+  // once everything is released the next allocation may start over at the front
+  if (usedBytes == 0) {
+    head = 0;
+  }
+
+  // a head exactly at the end wraps as well, with nothing to skip
+  bool wrap = head + size > this->size;
+  uint64_t skipped = wrap ? this->size - head : 0;
+  if (usedBytes + skipped + size > this->size) {
+    return false;
+  }
+  offset = wrap ? 0 : head;
+  head = offset + size;
+  usedBytes += skipped + size;
+  openBatchBytes += skipped + size;
+  return true;
+}
+
+uint64_t LveStagingRing::closeBatch() {
+  uint64_t bytes = openBatchBytes;
+  openBatchBytes = 0;
+  return bytes;
+}
+
+void LveStagingRing::release(uint64_t bytes) {
+  assert(bytes <= usedBytes - openBatchBytes && "Released more than the closed batches hold");
+  usedBytes -= bytes;
+}
+
+}  // namespace lve
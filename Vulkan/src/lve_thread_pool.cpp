@@ -0,0 +1,119 @@
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace lve {
+
+LveThreadPool::LveThreadPool(uint32_t threadCount) {
+  threadCount = std::max(threadCount, 1u);
+  workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+LveThreadPool::~LveThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+LveThreadPool &LveThreadPool::shared() {
+  static LveThreadPool pool{};
+  return pool;
+}
+
+uint32_t LveThreadPool::defaultThreadCount() {
+  // leave one core for the render thread
+  uint32_t hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void LveThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    tasks.push_back(std::move(task));
+  }
+  condition.notify_one();
+}
+
+void LveThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (stopping && tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void LveThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1) {
+    fn(0);
+    return;
+  }
+
+  struct Job {
+    std::atomic<uint32_t> next{0};
+    std::atomic<uint32_t> completed{0};
+    uint32_t count;
+    const std::function<void(uint32_t)> *fn;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+  auto job = std::make_shared<Job>();
+  job->count = count;
+  job->fn = &fn;
+
+  // helpers that start after every index has been claimed return without touching fn, so the
+  // job state is shared but fn only has to outlive this call
+  auto run = [job]() {
+    uint32_t i;
+    while ((i = job->next.fetch_add(1)) < job->count) {
+      try {
+        (*job->fn)(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{job->mutex};
+        if (!job->error) {
+          job->error = std::current_exception();
+        }
+      }
+      if (job->completed.fetch_add(1) + 1 == job->count) {
+        std::lock_guard<std::mutex> lock{job->mutex};
+        job->done.notify_all();
+      }
+    }
+  };
+
+  uint32_t helperCount = std::min(count - 1, getThreadCount());
+  for (uint32_t i = 0; i < helperCount; i++) {
+    enqueue(run);
+  }
+  run();
+
+  std::unique_lock<std::mutex> lock{job->mutex};
+  job->done.wait(lock, [&job]() { return job->completed.load() == job->count; });
+  if (job->error) {
+    std::rethrow_exception(job->error);
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,400 @@
+#include "lve_upload_context.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+// keeps every staging offset valid for buffer to image copies of any common texel size
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+LveUploadContext::LveUploadContext(LveDevice &device, VkDeviceSize stagingSize)
+    : lveDevice{device}, stagingSize{alignUp(stagingSize, STAGING_ALIGNMENT)}, ring{this->stagingSize} {
+  QueueFamilyIndices indices = lveDevice.findPhysicalQueueFamilies();
+  dedicatedTransfer = lveDevice.hasDedicatedTransferQueue();
+  graphicsFamily = indices.graphicsFamily;
+  transferFamily = dedicatedTransfer ? indices.transferFamily : indices.graphicsFamily;
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = transferFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+  if (dedicatedTransfer) {
+    poolInfo.queueFamilyIndex = graphicsFamily;
+    if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &acquireCommandPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload acquire command pool!");
+    }
+  }
+
+  lveDevice.createBuffer(
+      this->stagingSize,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      stagingBuffer,
+      stagingAllocation);
+  stagingData = static_cast<char *>(stagingAllocation.mappedData);
+}
+
+LveUploadContext::~LveUploadContext() {
+  waitIdle();
+
+  if (recording.commandBuffer != VK_NULL_HANDLE) {
+    freeBatches.push_back(recording);
+  }
+  for (auto &batch : freeBatches) {
+    vkDestroyFence(lveDevice.device(), batch.fence, nullptr);
+    if (dedicatedTransfer) {
+      vkDestroySemaphore(lveDevice.device(), batch.transferComplete, nullptr);
+      vkDestroyFence(lveDevice.device(), batch.acquireFence, nullptr);
+    }
+  }
+  vkDestroyCommandPool(lveDevice.device(), commandPool, nullptr);
+  if (acquireCommandPool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(lveDevice.device(), acquireCommandPool, nullptr);
+  }
+  lveDevice.destroyBuffer(stagingBuffer, stagingAllocation);
+}
+
+void LveUploadContext::uploadBuffer(
+    VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size, bool concurrentSharing) {
+  // large buffers go through the ring in pieces so they never need the whole ring at once
+  const char *source = static_cast<const char *>(data);
+  const VkDeviceSize maxChunkSize = stagingSize / 4;
+  while (size > 0) {
+    VkDeviceSize chunkSize = std::min(size, maxChunkSize);
+    VkDeviceSize stagingOffset = allocateStaging(chunkSize);
+    memcpy(stagingData + stagingOffset, source, chunkSize);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = chunkSize;
+    vkCmdCopyBuffer(getRecordingCommandBuffer(), stagingBuffer, dstBuffer, 1, &copyRegion);
+    if (dedicatedTransfer && !concurrentSharing &&
+        (recording.buffers.empty() || recording.buffers.back() != dstBuffer)) {
+      recording.buffers.push_back(dstBuffer);
+    }
+
+    recording.copyCount++;
+    stats.copyCount++;
+    stats.bytesUploaded += chunkSize;
+    source += chunkSize;
+    dstOffset += chunkSize;
+    size -= chunkSize;
+  }
+}
+
+void LveUploadContext::uploadImage(
+    VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void *data, VkDeviceSize size) {
+  if (size > stagingSize) {
+    throw std::runtime_error("image upload does not fit into the staging ring!");
+  }
+
+  VkDeviceSize stagingOffset = allocateStaging(size);
+  memcpy(stagingData + stagingOffset, data, size);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = stagingOffset;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layerCount;
+
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+
+  vkCmdCopyBufferToImage(
+      getRecordingCommandBuffer(),
+      stagingBuffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+  if (dedicatedTransfer) {
+    recording.images.push_back(image);
+  }
+
+  recording.copyCount++;
+  stats.copyCount++;
+  stats.bytesUploaded += size;
+}
+
+LveUploadContext::Token LveUploadContext::flush() {
+  if (recording.copyCount == 0) {
+    return nextToken - 1;
+  }
+
+  if (dedicatedTransfer) {
+    recordOwnershipTransfer(recording.commandBuffer, recording, true);
+  } else {
+    // make the copies visible to every later command on this queue
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    vkCmdPipelineBarrier(
+        recording.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload command buffer!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &recording.commandBuffer;
+  if (dedicatedTransfer) {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &recording.transferComplete;
+  }
+  if (vkQueueSubmit(lveDevice.transferQueue(), 1, &submitInfo, recording.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+
+  if (inFlight.empty()) {
+    busyStart = std::chrono::steady_clock::now();
+  }
+  recording.token = nextToken++;
+  recording.ringBytes = ring.closeBatch();
+  inFlight.push_back(recording);
+  recording = Batch{};
+  stats.submitCount++;
+  return inFlight.back().token;
+}
+
+bool LveUploadContext::isComplete(Token token) {
+  retireCompleted();
+  return token <= completedToken;
+}
+
+void LveUploadContext::wait(Token token) {
+  while (completedToken < token && !inFlight.empty()) {
+    waitOldest();
+  }
+}
+
+void LveUploadContext::waitIdle() {
+  flush();
+  while (!inFlight.empty()) {
+    waitOldest();
+  }
+}
+
+VkDeviceSize LveUploadContext::allocateStaging(VkDeviceSize size) {
+  uint64_t offset = 0;
+  while (!ring.allocate(size, STAGING_ALIGNMENT, offset)) {
+    stats.stallCount++;
+    flush();
+    waitOldest();
+  }
+  return offset;
+}
+
+VkCommandBuffer LveUploadContext::getRecordingCommandBuffer() {
+  if (recording.commandBuffer != VK_NULL_HANDLE) {
+    return recording.commandBuffer;
+  }
+
+  if (!freeBatches.empty()) {
+    recording = freeBatches.back();
+    freeBatches.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload fence!");
+    }
+
+    if (dedicatedTransfer) {
+      allocInfo.commandPool = acquireCommandPool;
+      VkSemaphoreCreateInfo semaphoreInfo{};
+      semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &recording.acquireCommandBuffer) != VK_SUCCESS ||
+          vkCreateSemaphore(lveDevice.device(), &semaphoreInfo, nullptr, &recording.transferComplete) != VK_SUCCESS ||
+          vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &recording.acquireFence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload ownership transfer objects!");
+      }
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(recording.commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording upload command buffer!");
+  }
+  return recording.commandBuffer;
+}
+
+void LveUploadContext::recordOwnershipTransfer(VkCommandBuffer commandBuffer, const Batch &batch, bool release) {
+  // release and acquire must describe the same transfer; access masks on the far side are ignored
+  std::vector<VkBufferMemoryBarrier> bufferBarriers(batch.buffers.size());
+  for (size_t i = 0; i < batch.buffers.size(); i++) {
+    VkBufferMemoryBarrier &barrier = bufferBarriers[i];
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+    barrier.dstAccessMask = release ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.buffer = batch.buffers[i];
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+  }
+
+  std::vector<VkImageMemoryBarrier> imageBarriers(batch.images.size());
+  for (size_t i = 0; i < batch.images.size(); i++) {
+    VkImageMemoryBarrier &barrier = imageBarriers[i];
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+    barrier.dstAccessMask = release ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.image = batch.images[i];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+  }
+
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      release ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(),
+      static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
+}
+
+void LveUploadContext::submitAcquire(Batch &batch) {
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  if (vkBeginCommandBuffer(batch.acquireCommandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording upload acquire command buffer!");
+  }
+  recordOwnershipTransfer(batch.acquireCommandBuffer, batch, false);
+  if (vkEndCommandBuffer(batch.acquireCommandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record upload acquire command buffer!");
+  }
+
+  // the copies already finished, so the wait is satisfied the moment the graphics queue reaches it
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.pWaitSemaphores = &batch.transferComplete;
+  submitInfo.pWaitDstStageMask = &waitStage;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+  if (vkQueueSubmit(lveDevice.graphicsQueue(), 1, &submitInfo, batch.acquireFence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload acquire command buffer!");
+  }
+  batch.acquireSubmitted = true;
+}
+
+bool LveUploadContext::isBatchComplete(const Batch &batch) {
+  if (dedicatedTransfer) {
+    return batch.acquireSubmitted && vkGetFenceStatus(lveDevice.device(), batch.acquireFence) == VK_SUCCESS;
+  }
+  return vkGetFenceStatus(lveDevice.device(), batch.fence) == VK_SUCCESS;
+}
+
+void LveUploadContext::retireCompleted() {
+  if (dedicatedTransfer) {
+    for (auto &batch : inFlight) {
+      if (batch.acquireSubmitted) {
+        continue;
+      }
+      if (vkGetFenceStatus(lveDevice.device(), batch.fence) != VK_SUCCESS) {
+        break;
+      }
+      submitAcquire(batch);
+    }
+  }
+
+  // batches retire in submission order so the ring is always released from its tail
+  while (!inFlight.empty() && isBatchComplete(inFlight.front())) {
+    Batch &batch = inFlight.front();
+    ring.release(batch.ringBytes);
+    completedToken = batch.token;
+
+    vkResetFences(lveDevice.device(), 1, &batch.fence);
+    vkResetCommandBuffer(batch.commandBuffer, 0);
+    Batch recycled{};
+    recycled.commandBuffer = batch.commandBuffer;
+    recycled.fence = batch.fence;
+    if (dedicatedTransfer) {
+      vkResetFences(lveDevice.device(), 1, &batch.acquireFence);
+      vkResetCommandBuffer(batch.acquireCommandBuffer, 0);
+      recycled.transferComplete = batch.transferComplete;
+      recycled.acquireCommandBuffer = batch.acquireCommandBuffer;
+      recycled.acquireFence = batch.acquireFence;
+    }
+    freeBatches.push_back(recycled);
+    inFlight.pop_front();
+
+    if (inFlight.empty()) {
+      stats.busySeconds +=
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - busyStart).count();
+    }
+  }
+}
+
+void LveUploadContext::waitOldest() {
+  if (inFlight.empty()) {
+    return;
+  }
+  Batch &batch = inFlight.front();
+  vkWaitForFences(lveDevice.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+  if (dedicatedTransfer) {
+    if (!batch.acquireSubmitted) {
+      submitAcquire(batch);
+    }
+    vkWaitForFences(lveDevice.device(), 1, &batch.acquireFence, VK_TRUE, UINT64_MAX);
+  }
+  retireCompleted();
+}
+
+}  // namespace lve
@@ -0,0 +1,180 @@
+#include "lve_vertex_quantizer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lve {
+
+namespace {
+
+uint16_t toUnorm16(float value) {
+  return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+}
+
+int16_t toSnorm16(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+uint8_t toUnorm8(float value) {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+}
+
+float signNotZero(float value) { return value >= 0.f ? 1.f : -1.f; }
+
+}  // namespace
+
+LveVertexQuantizer::LveVertexQuantizer(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+    : boundsMin{boundsMin}, extent{boundsMax - boundsMin} {
+  // a flat axis still needs a non-zero scale to stay invertible
+  for (int i = 0; i < 3; i++) {
+    if (extent[i] <= 0.f) extent[i] = 1.f;
+  }
+}
+
+LveCompactVertex LveVertexQuantizer::encode(
+    const glm::vec3 &position, const glm::vec3 &color, const glm::vec3 &normal, const glm::vec2 &uv) const {
+  LveCompactVertex vertex{};
+  glm::vec3 normalized = (position - boundsMin) / extent;
+  glm::vec2 octahedral = encodeOctahedral(normal);
+  for (int i = 0; i < 3; i++) {
+    vertex.position[i] = toUnorm16(normalized[i]);
+    vertex.color[i] = toUnorm8(color[i]);
+  }
+  vertex.color[3] = 255;
+  vertex.normal[0] = toSnorm16(octahedral.x);
+  vertex.normal[1] = toSnorm16(octahedral.y);
+  vertex.uv[0] = floatToHalf(uv.x);
+  vertex.uv[1] = floatToHalf(uv.y);
+  return vertex;
+}
+
+void LveVertexQuantizer::decode(
+    const LveCompactVertex &vertex, glm::vec3 &position, glm::vec3 &color, glm::vec3 &normal, glm::vec2 &uv) const {
+  for (int i = 0; i < 3; i++) {
+    position[i] = boundsMin[i] + (vertex.position[i] / 65535.f) * extent[i];
+    color[i] = vertex.color[i] / 255.f;
+  }
+  glm::vec2 octahedral{
+      std::max(vertex.normal[0] / 32767.f, -1.f),
+      std::max(vertex.normal[1] / 32767.f, -1.f)};
+  normal = decodeOctahedral(octahedral);
+  uv = {halfToFloat(vertex.uv[0]), halfToFloat(vertex.uv[1])};
+}
+
+glm::mat4 LveVertexQuantizer::getDequantizationMatrix() const {
+  glm::mat4 matrix{1.f};
+  matrix[0][0] = extent.x;
+  matrix[1][1] = extent.y;
+  matrix[2][2] = extent.z;
+  matrix[3] = glm::vec4{boundsMin, 1.f};
+  return matrix;
+}
+
+LveVertexQuantizer::Error LveVertexQuantizer::getErrorBound(float uvRange) const {
+  Error bound{};
+  // half a quantization step per axis, plus float rounding in the reconstruction
+  glm::vec3 step = extent / 65535.f;
+  bound.position = 0.5f * glm::length(step) + 1e-6f * glm::length(boundsMin + extent);
+  // 16-bit octahedral encoding stays well below 0.001 rad
+  bound.normal = 0.001f;
+  // halfs keep 11 significant bits, so rounding is relative to the magnitude
+  bound.uv = std::max(uvRange, 1.f) / 2048.f;
+  bound.color = 0.5f / 255.f + 1e-6f;
+  return bound;
+}
+
+glm::vec2 LveVertexQuantizer::encodeOctahedral(const glm::vec3 &normal) {
+  float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (sum == 0.f) {
+    return glm::vec2{0.f, 0.f};
+  }
+  glm::vec3 n = normal / sum;
+  glm::vec2 encoded{n.x, n.y};
+  if (n.z < 0.f) {
+    encoded = glm::vec2{
+        (1.f - std::abs(n.y)) * signNotZero(n.x),
+        (1.f - std::abs(n.x)) * signNotZero(n.y)};
+  }
+  return encoded;
+}
+
+glm::vec3 LveVertexQuantizer::decodeOctahedral(const glm::vec2 &encoded) {
+  glm::vec3 n{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+  float t = std::max(-n.z, 0.f);
+  n.x += n.x >= 0.f ? -t : t;
+  n.y += n.y >= 0.f ? -t : t;
+  float length = glm::length(n);
+  return length > 0.f ? n / length : n;
+}
+
+// IEEE 754 binary16 conversion with round-to-nearest-even, denormals, infinities and NaN
+uint16_t LveVertexQuantizer::floatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  uint32_t exponent = (bits >> 23) & 0xffu;
+  uint32_t mantissa = bits & 0x7fffffu;
+
+  if (exponent == 0xffu) {
+    return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+  }
+
+  int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+  if (halfExponent >= 0x1f) {
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (halfExponent <= 0) {
+    if (halfExponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000u;
+    uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+    uint32_t halfMantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1u);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (halfMantissa & 1u))) {
+      halfMantissa++;
+    }
+    return static_cast<uint16_t>(sign | halfMantissa);
+  }
+
+  uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    half++;  // may carry into the exponent, which correctly rounds up to the next power or infinity
+  }
+  return static_cast<uint16_t>(half);
+}
+
+float LveVertexQuantizer::halfToFloat(uint16_t value) {
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+  uint32_t exponent = (value >> 10) & 0x1fu;
+  uint32_t mantissa = value & 0x3ffu;
+
+  uint32_t bits;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // renormalize the denormal
+      exponent = 127 - 15 + 1;
+      while ((mantissa & 0x400u) == 0) {
+        mantissa <<= 1;
+        exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+  } else if (exponent == 0x1f) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+}  // namespace lve
@@ -0,0 +1,128 @@
+#include "lve_vertex_welder.hpp"
+
+// std
+#include <cmath>
+#include <cstring>
+
+namespace lve {
+
+static_assert(
+    sizeof(LveModel::Vertex) % sizeof(uint32_t) == 0,
+    "Vertex must be made of 32-bit components to be hashed as words");
+
+namespace {
+
+// the int32 range in floats; 2^31 - 128 is the largest float below 2^31
+constexpr float MIN_CELL = -2147483648.f;
+constexpr float MAX_CELL = 2147483520.f;
+
+size_t nextPowerOfTwo(size_t value) {
+  size_t result = 16;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+}  // namespace
+
+LveVertexWelder::LveVertexWelder(
+    std::vector<LveModel::Vertex> &vertices, size_t expectedInsertions, float epsilon)
+    : vertices{vertices}, inverseEpsilon{epsilon > 0.f ? 1.f / epsilon : 0.f} {
+  // the insert count is an upper bound on the unique count, so this stays under 80% load
+  size_t capacity = nextPowerOfTwo(expectedInsertions + expectedInsertions / 4);
+  slots.assign(capacity, Slot{0, EMPTY});
+  mask = capacity - 1;
+  vertices.reserve(vertices.size() + expectedInsertions / 2);
+}
+
+LveVertexWelder::Key LveVertexWelder::makeKey(const LveModel::Vertex &vertex) const {
+  Key key;
+  if (inverseEpsilon > 0.f) {
+    const float *components = reinterpret_cast<const float *>(&vertex);
+    for (uint32_t i = 0; i < KEY_WORDS; i++) {
+      // clamped first, since converting a float outside the int32 range is undefined; fmin and fmax
+      // also turn NaN into a bound
+      float cell = std::floor(components[i] * inverseEpsilon + 0.5f);
+      cell = std::fmax(std::fmin(cell, MAX_CELL), MIN_CELL);
+      key.words[i] = static_cast<uint32_t>(static_cast<int32_t>(cell));
+    }
+  } else {
+    memcpy(key.words, &vertex, sizeof(Key));
+    // -0.0f compares equal to 0.0f, so it has to hash the same as well
+    for (uint32_t i = 0; i < KEY_WORDS; i++) {
+      if (key.words[i] == 0x80000000u) key.words[i] = 0;
+    }
+  }
+  return key;
+}
+
+// Four independent multiply-accumulate lanes over the key words (vectorizes to a single SIMD
+// register per step), folded and finished with the murmur3 avalanche.
+uint32_t LveVertexWelder::hashKey(const Key &key) {
+  static constexpr uint32_t PRIME1 = 0x9e3779b1u;
+  static constexpr uint32_t PRIME2 = 0x85ebca77u;
+  uint32_t lanes[4] = {0x27d4eb2fu, 0x165667b1u, 0xc2b2ae3du, 0x61c88647u};
+  uint32_t i = 0;
+  for (; i + 4 <= KEY_WORDS; i += 4) {
+    for (uint32_t lane = 0; lane < 4; lane++) {
+      lanes[lane] = (lanes[lane] + key.words[i + lane] * PRIME2) * PRIME1;
+    }
+  }
+  for (uint32_t lane = 0; i < KEY_WORDS; i++, lane++) {
+    lanes[lane] = (lanes[lane] + key.words[i] * PRIME2) * PRIME1;
+  }
+
+  uint32_t h = lanes[0] ^ (lanes[1] << 7 | lanes[1] >> 25) ^ (lanes[2] << 13 | lanes[2] >> 19) ^
+               (lanes[3] << 19 | lanes[3] >> 13);
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+uint32_t LveVertexWelder::weld(const LveModel::Vertex &vertex) {
+  Key key = makeKey(vertex);
+  uint32_t hash = hashKey(key);
+
+  size_t slot = hash & mask;
+  while (true) {
+    Slot &entry = slots[slot];
+    if (entry.index == EMPTY) {
+      break;
+    }
+    if (entry.hash == hash) {
+      Key existing = makeKey(vertices[entry.index]);
+      if (memcmp(existing.words, key.words, sizeof(Key)) == 0) {
+        return entry.index;
+      }
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  uint32_t index = static_cast<uint32_t>(vertices.size());
+  vertices.push_back(vertex);
+  slots[slot] = Slot{hash, index};
+
+  // only reached when the caller underestimated the insert count
+  if (vertices.size() * 5 > slots.size() * 4) {
+    grow();
+  }
+  return index;
+}
+
+void LveVertexWelder::grow() {
+  std::vector<Slot> oldSlots = std::move(slots);
+  slots.assign(oldSlots.size() * 2, Slot{0, EMPTY});
+  mask = slots.size() - 1;
+  for (const Slot &entry : oldSlots) {
+    if (entry.index == EMPTY) continue;
+    size_t slot = entry.hash & mask;
+    while (slots[slot].index != EMPTY) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = entry;
+  }
+}
+
+}  // namespace lve
@@ -7,9 +7,12 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
+#include <string>
 
 #include <iostream>
 
@@ -24,7 +27,8 @@ struct SimplePushConstantData {
 SimpleRenderSystem::SimpleRenderSystem(LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
     : lveDevice{device} {
   createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+  // compact vertices are opt-in at import, so their pipelines wait until a model uses them
+  createPipelines(renderPass, VertexFormat::Float);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
@@ -50,40 +54,288 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
   }
 }
 
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::createPipelines(VkRenderPass renderPass, VertexFormat format) {
   assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
   PipelineConfigInfo pipelineConfig{};
   LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  lvePipeline = std::make_unique<LvePipeline>(lveDevice, "shaders/bin/simple_shader.vert.spv", "shaders/bin/simple_shader.frag.spv", pipelineConfig);
+
+  // instanced variants take the transform and color per instance from INSTANCE_BINDING
+  auto makePipeline = [&](VertexStream stream, bool instanced, const std::string& vertFilepath, const std::string& fragFilepath) {
+    pipelineConfig.bindingDescriptions = LveModel::Vertex::getBindingDescriptions(format, stream);
+    pipelineConfig.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions(format, stream);
+    if (instanced) {
+      addInstanceInputs(pipelineConfig);
+    }
+    return std::make_unique<LvePipeline>(lveDevice, vertFilepath, fragFilepath, pipelineConfig);
+  };
+  auto createShadedPipelines = [&](PipelineSet& pipelines) {
+    const std::string fragFilepath = "shaders/bin/simple_shader.frag.spv";
+    if (format == VertexFormat::Compact) {
+      pipelines.compact = makePipeline(VertexStream::Interleaved, false, "shaders/bin/simple_shader_compact.vert.spv", fragFilepath);
+      pipelines.compactInstanced = makePipeline(VertexStream::Interleaved, true, "shaders/bin/simple_shader_compact_instanced.vert.spv", fragFilepath);
+    } else {
+      pipelines.plain = makePipeline(VertexStream::Interleaved, false, "shaders/bin/simple_shader.vert.spv", fragFilepath);
+      pipelines.instanced = makePipeline(VertexStream::Interleaved, true, "shaders/bin/simple_shader_instanced.vert.spv", fragFilepath);
+    }
+  };
+  createShadedPipelines(shadedPipelines);
+
+  LvePipeline::depthEqualPipelineConfigInfo(pipelineConfig);
+  createShadedPipelines(depthEqualPipelines);
+
+  // compact and float positions differ only in their vertex input format
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  LvePipeline::depthOnlyPipelineConfigInfo(pipelineConfig);
+  auto plain = makePipeline(VertexStream::Position, false, "shaders/bin/depth_only.vert.spv", "");
+  auto instanced = makePipeline(VertexStream::Position, true, "shaders/bin/depth_only_instanced.vert.spv", "");
+  if (format == VertexFormat::Compact) {
+    depthOnlyPipelines.compact = std::move(plain);
+    depthOnlyPipelines.compactInstanced = std::move(instanced);
+  } else {
+    depthOnlyPipelines.plain = std::move(plain);
+    depthOnlyPipelines.instanced = std::move(instanced);
+  }
+}
+
+LvePipeline* SimpleRenderSystem::PipelineSet::select(bool compactVertices, bool instancedDraw) const {
+  if (instancedDraw) {
+    return (compactVertices ? compactInstanced : instanced).get();
+  }
+  return (compactVertices ? compact : plain).get();
+}
+
+void SimpleRenderSystem::addInstanceInputs(PipelineConfigInfo& configInfo) {
+  configInfo.bindingDescriptions.push_back({INSTANCE_BINDING, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE});
+  // a mat4 takes one location per column
+  for (uint32_t column = 0; column < 4; column++) {
+    configInfo.attributeDescriptions.push_back(
+        {4 + column, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT,
+         static_cast<uint32_t>(offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4))});
+  }
+  for (uint32_t column = 0; column < 3; column++) {
+    configInfo.attributeDescriptions.push_back(
+        {8 + column, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT,
+         static_cast<uint32_t>(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4))});
+  }
+  configInfo.attributeDescriptions.push_back(
+      {11, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceData, color))});
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, std::vector<LveGameObject>& gameObjects) {
-  lvePipeline->bind(frameInfo.commandBuffer);
-
-  vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      pipelineLayout,
-      0,
-      1,
-      &frameInfo.globalDescriptorSet,
-      0,
-      nullptr
-  );
-
-  for (auto& obj : gameObjects) {
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
-    push.color = obj.color;
-
-    vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+  // world-space error e at distance d covers e * pixelsPerUnit / d pixels; an orthographic
+  // projection has no distance falloff
+  const glm::mat4& projection = frameInfo.camera.getProjection();
+  const bool perspective = projection[2][3] != 0.f;
+  const float pixelsPerUnit = glm::abs(projection[1][1]) * 0.5f * static_cast<float>(frameInfo.extent.height);
+  const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+  const glm::mat4 projectionView = projection * frameInfo.camera.getView();
+
+  cullList.clear();
+  cullObjects.clear();
+  modelMatrices.resize(gameObjects.size());
+  for (uint32_t i = 0; i < gameObjects.size(); i++) {
+    auto& obj = gameObjects[i];
+    if (obj.model == nullptr) {
+      continue;
+    }
+    modelMatrices[i] = obj.transform.mat4();
+    cullList.add(modelMatrices[i], obj.model->getBoundingBoxMin(), obj.model->getBoundingBoxMax());
+    cullObjects.push_back(i);
+  }
+  visibleEntries.resize(cullList.size());
+  uint32_t visibleCount = cullList.cull(frameInfo.camera.getFrustum(), visibleEntries.data());
+  culledCount = cullList.size() - visibleCount;
+
+  drawItems.clear();
+  renderQueue.clear();
+  stats = {};
+  for (uint32_t v = 0; v < visibleCount; v++) {
+    uint32_t i = cullObjects[visibleEntries[v]];
+    auto& obj = gameObjects[i];
+    const glm::mat4& modelMatrix = modelMatrices[i];
+
+    glm::vec3 scale = glm::abs(obj.transform.scale);
+    float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f));
+    float distance = glm::length(center - cameraPosition);
+    float objectPixelsPerUnit = maxScale * pixelsPerUnit;
+    if (perspective) {
+      objectPixelsPerUnit /= std::max(distance - obj.model->getBoundingRadius() * maxScale, 1e-3f);
+    }
+    uint32_t lod = obj.model->selectLod(objectPixelsPerUnit, maxLodPixelError);
+
+    // objects have no materials yet, so that field of the key stays zero
+    renderQueue.push(
+        LveRenderQueue::makeKey(
+            static_cast<uint32_t>(obj.model->getVertexFormat()), distance, obj.model->getId(), lod, 0),
+        static_cast<uint32_t>(drawItems.size()));
+    drawItems.push_back({obj.model.get(), lod, i});
+  }
+  if (drawItems.empty()) {
+    return;
+  }
+
+  // objects drawing the same LOD of the same model end up adjacent and become one instanced draw;
+  // the vertex format decides the pipeline and sorts first to keep pipeline switches to a minimum
+  renderQueue.sort();
+  sortedItems.clear();
+  for (size_t i = 0; i < renderQueue.size(); i++) {
+    sortedItems.push_back(drawItems[renderQueue[i].item]);
+  }
+  drawItems.swap(sortedItems);
+  // the vertex format sorts first, so any compact model is last
+  if (drawItems.back().model->getVertexFormat() == VertexFormat::Compact && shadedPipelines.compact == nullptr) {
+    createPipelines(frameInfo.renderPass, VertexFormat::Compact);
+  }
+
+  // compact positions are dequantized by folding the bounds into the model matrix
+  LveFrameAllocator::Allocation instances = frameInfo.frameAllocator.allocate(drawItems.size() * sizeof(InstanceData));
+  InstanceData* instanceData = static_cast<InstanceData*>(instances.data);
+  for (size_t i = 0; i < drawItems.size(); i++) {
+    auto& obj = gameObjects[drawItems[i].objectIndex];
+    const glm::mat3 normalMatrix = obj.transform.normalMatrix();
+    instanceData[i].modelMatrix = modelMatrices[drawItems[i].objectIndex] * drawItems[i].model->getDequantizationMatrix();
+    instanceData[i].normalMatrix[0] = glm::vec4(normalMatrix[0], 0.f);
+    instanceData[i].normalMatrix[1] = glm::vec4(normalMatrix[1], 0.f);
+    instanceData[i].normalMatrix[2] = glm::vec4(normalMatrix[2], 0.f);
+    instanceData[i].color = glm::vec4(obj.color, 1.f);
+  }
+
+  // objects drawing the same model and LOD form one batch, unless instancing is off
+  batches.clear();
+  for (uint32_t begin = 0; begin < drawItems.size();) {
+    uint32_t end = begin + 1;
+    while (instancing && end < drawItems.size() && drawItems[end].model == drawItems[begin].model &&
+           drawItems[end].lod == drawItems[begin].lod) {
+      end++;
+    }
+    batches.push_back({begin, end});
+    begin = end;
+  }
+
+  VkBuffer instanceBuffer = instances.buffer;
+  VkDeviceSize instanceOffset = instances.dynamicOffset;
+
+  // records batches [firstBatch, endBatch) of the depth prepass or of the shading pass with its own
+  // view of the bound state; only reads shared data, so several can run at once on different
+  // command buffers. Both passes make the same draws, or EQUAL testing would drop fragments; models
+  // imported without a position stream skip the prepass and shade with the plain depth test instead
+  auto recordBatches = [&](VkCommandBuffer commandBuffer, size_t firstBatch, size_t endBatch, bool depthOnly, Stats& batchStats) {
+    const VertexStream stream = depthOnly ? VertexStream::Position : VertexStream::Interleaved;
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &frameInfo.globalDescriptorSet,
+        1,
+        &frameInfo.globalUboOffset);
+    vkCmdBindVertexBuffers(commandBuffer, INSTANCE_BINDING, 1, &instanceBuffer, &instanceOffset);
+
+    LvePipeline* boundPipeline = nullptr;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_UINT32;
+    for (size_t b = firstBatch; b < endBatch; b++) {
+      const uint32_t begin = batches[b].begin;
+      const DrawItem& item = drawItems[begin];
+      LveModel& model = *item.model;
+      uint32_t instanceCount = batches[b].end - begin;
+      bool prepassed = depthPrepass && model.hasPositionStream();
+      if (depthOnly && !prepassed) {
+        continue;
+      }
+      const PipelineSet& pipelines = depthOnly ? depthOnlyPipelines : prepassed ? depthEqualPipelines : shadedPipelines;
+
+      // a lone full-detail model is better served by culling its meshlets than by instancing
+      bool cullMeshlets = instanceCount == 1 && clusterCulling && item.lod == 0 && model.hasMeshlets();
+      bool compact = model.getVertexFormat() == VertexFormat::Compact;
+      LvePipeline* pipeline = pipelines.select(compact, !cullMeshlets);
+      batchStats.batchCount++;
+      if (pipeline != boundPipeline) {
+        boundPipeline = pipeline;
+        pipeline->bind(commandBuffer);
+        batchStats.pipelineBinds++;
+      } else {
+        batchStats.pipelineBindsSkipped++;
+      }
+
+      // models share the geometry pool buffers, so most draws only need their offsets
+      if (model.getVertexBuffer(stream) != boundVertexBuffer || model.getIndexBuffer() != boundIndexBuffer ||
+          model.getIndexType() != boundIndexType) {
+        boundVertexBuffer = model.getVertexBuffer(stream);
+        boundIndexBuffer = model.getIndexBuffer();
+        boundIndexType = model.getIndexType();
+        model.bind(commandBuffer, stream);
+        batchStats.geometryBinds++;
+      } else {
+        batchStats.geometryBindsSkipped++;
+      }
+
+      if (cullMeshlets) {
+        auto& obj = gameObjects[item.objectIndex];
+        const glm::mat4& modelMatrix = modelMatrices[item.objectIndex];
+        SimplePushConstantData push{};
+        push.modelMatrix = instanceData[begin].modelMatrix;
+        push.normalMatrix = obj.transform.normalMatrix();
+        push.color = obj.color;
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+        // meshlet bounds are in model space, so bring the frustum and camera there instead
+        Frustum frustum = Frustum::fromMatrix(projectionView * modelMatrix);
+        glm::vec3 viewPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.f));
+        model.drawMeshlets(commandBuffer, frustum, viewPosition, stream);
+      } else {
+        model.draw(commandBuffer, item.lod, instanceCount, begin, stream);
+      }
+    }
+  };
+
+  const auto recordStart = std::chrono::high_resolution_clock::now();
+  if (commandRecorder == nullptr) {
+    if (depthPrepass) {
+      recordBatches(frameInfo.commandBuffer, 0, batches.size(), true, stats);
+    }
+    recordBatches(frameInfo.commandBuffer, 0, batches.size(), false, stats);
+    stats.recordMilliseconds = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - recordStart).count();
+    return;
+  }
+
+  // contiguous slices keep each worker's state changes as few as in a single sorted stream. The
+  // prepass is recorded and executed as a whole first, so all depth is in place before shading
+  uint32_t taskCount = static_cast<uint32_t>(std::min<size_t>(
+      commandRecorder->getWorkerCount(), (batches.size() + MIN_BATCHES_PER_TASK - 1) / MIN_BATCHES_PER_TASK));
+  workerStats.assign(taskCount, Stats{});
+  for (bool depthOnly : {true, false}) {
+    if (depthOnly && !depthPrepass) {
+      continue;
+    }
+    commandRecorder->record(
+        frameInfo.commandBuffer,
+        frameInfo.renderPass,
+        frameInfo.framebuffer,
+        frameInfo.extent,
+        taskCount,
+        [&](uint32_t worker, VkCommandBuffer commandBuffer) {
+          size_t firstBatch = batches.size() * worker / taskCount;
+          size_t endBatch = batches.size() * (worker + 1) / taskCount;
+          recordBatches(commandBuffer, firstBatch, endBatch, depthOnly, workerStats[worker]);
+        });
+  }
+  for (const Stats& workerStat : workerStats) {
+    stats.batchCount += workerStat.batchCount;
+    stats.pipelineBinds += workerStat.pipelineBinds;
+    stats.pipelineBindsSkipped += workerStat.pipelineBindsSkipped;
+    stats.geometryBinds += workerStat.geometryBinds;
+    stats.geometryBindsSkipped += workerStat.geometryBindsSkipped;
   }
+  stats.recordMilliseconds = std::chrono::duration<float, std::milli>(
+      std::chrono::high_resolution_clock::now() - recordStart).count();
 }
 
 }  // namespace lve
@@ -0,0 +1,230 @@
+#include "lve_allocator.hpp"
+#include "lve_test.hpp"
+#include "lve_test_device.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+struct LiveAllocation {
+  LveAllocation allocation;
+  VkDeviceSize requestedSize;
+  uint8_t pattern;
+};
+
+// Memory types the test can allocate from without enabling extra device features
+bool isTestable(const VkMemoryType &type) {
+  VkMemoryPropertyFlags unsupported = VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD |
+                                      VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD;
+  return (type.propertyFlags & unsupported) == 0;
+}
+
+}  // namespace
+
+// Allocates and frees random sizes and alignments across every memory type and checks each
+// allocation's placement, the dedicated threshold, the flush ranges of mapped memory and that
+// the statistics return to zero. Meant to run under a software driver as well (see
+// LveTestDevice for selecting lavapipe).
+LVE_TEST(allocatorStress) {
+  test::LveTestDevice testDevice;
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(testDevice.physicalDevice(), &memoryProperties);
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(testDevice.physicalDevice(), &properties);
+  const VkDeviceSize atomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+  std::vector<uint32_t> memoryTypes;
+  bool nonCoherentTested = false;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if (isTestable(memoryProperties.memoryTypes[i])) {
+      memoryTypes.push_back(i);
+      VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+      nonCoherentTested |=
+          (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+  }
+  LVE_CHECK(!memoryTypes.empty());
+  if (!nonCoherentTested) {
+    std::cout << "  no non-coherent host visible memory type; flush ranges are checked for alignment only"
+              << std::endl;
+  }
+
+  std::vector<LiveAllocation> live;
+  {
+    LveAllocator allocator{testDevice.physicalDevice(), testDevice.device(), testDevice.memoryBudgetSupported()};
+
+    std::mt19937 rng{11};
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    // live ranges per VkDeviceMemory, offset -> end
+    std::map<VkDeviceMemory, std::map<VkDeviceSize, VkDeviceSize>> ranges;
+    // the mapped base pointer every allocation in a block must agree on
+    std::map<VkDeviceMemory, const char *> mappedBases;
+    VkDeviceSize liveBytes = 0;
+    const VkDeviceSize maxLiveBytes = 256ull * 1024 * 1024;
+    uint8_t nextPattern = 1;
+
+    auto release = [&](size_t index) {
+      LiveAllocation entry = live[index];
+      live[index] = live.back();
+      live.pop_back();
+
+      const LveAllocation &allocation = entry.allocation;
+      if (allocation.mappedData != nullptr) {
+        // a neighbour writing into this range would have changed the pattern
+        const uint8_t *bytes = static_cast<const uint8_t *>(allocation.mappedData);
+        VkDeviceSize checked = std::min<VkDeviceSize>(entry.requestedSize, 64);
+        for (VkDeviceSize i = 0; i < checked; i++) {
+          LVE_CHECK(bytes[i] == entry.pattern && bytes[entry.requestedSize - 1 - i] == entry.pattern);
+        }
+      }
+      auto &memoryRanges = ranges[allocation.memory];
+      memoryRanges.erase(allocation.offset);
+      if (memoryRanges.empty()) {
+        ranges.erase(allocation.memory);
+        mappedBases.erase(allocation.memory);
+      }
+      liveBytes -= allocation.size;
+      allocator.free(entry.allocation);
+      LVE_CHECK(entry.allocation.memory == VK_NULL_HANDLE);
+    };
+
+    for (int iteration = 0; iteration < 20000; iteration++) {
+      bool allocate = live.empty() || (unit(rng) < 0.55 && liveBytes < maxLiveBytes);
+      if (!allocate) {
+        release(static_cast<size_t>(unit(rng) * live.size()) % live.size());
+        continue;
+      }
+
+      uint32_t memoryTypeIndex = memoryTypes[static_cast<size_t>(unit(rng) * memoryTypes.size()) % memoryTypes.size()];
+      VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+      bool coherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+      bool hostVisible = flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+      bool lazy = flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+      VkDeviceSize blockSize = allocator.getBlockSize(memoryTypeIndex);
+
+      VkMemoryRequirements requirements{};
+      requirements.memoryTypeBits = 1u << memoryTypeIndex;
+      requirements.alignment = VkDeviceSize{1} << static_cast<uint32_t>(unit(rng) * 17);
+      double roll = unit(rng);
+      if (roll < 0.02) {
+        // straddle the dedicated threshold
+        requirements.size = blockSize / 2 - 64 + static_cast<VkDeviceSize>(unit(rng) * 128);
+      } else {
+        // log-uniform between 1 byte and 4 MB
+        requirements.size = std::max<VkDeviceSize>(1, static_cast<VkDeviceSize>(std::exp2(unit(rng) * 22.0)));
+      }
+      auto type = unit(rng) < 0.5 ? LveAllocator::ResourceType::Buffer : LveAllocator::ResourceType::Image;
+      auto category = static_cast<LveMemoryCategory>(static_cast<uint32_t>(unit(rng) * LVE_MEMORY_CATEGORY_COUNT) % LVE_MEMORY_CATEGORY_COUNT);
+
+      LveAllocation allocation = allocator.allocate(requirements, flags, type, category);
+      LVE_CHECK(allocation.memory != VK_NULL_HANDLE);
+      LVE_CHECK(allocation.poolIndex / 2 == memoryTypeIndex);
+      LVE_CHECK(allocation.category == category);
+      LVE_CHECK(allocation.size >= requirements.size);
+      LVE_CHECK(allocation.offset % requirements.alignment == 0);
+      if (!coherent && hostVisible) {
+        LVE_CHECK(allocation.offset % atomSize == 0 && allocation.size % atomSize == 0);
+      }
+
+      VkDeviceSize effectiveSize = coherent ? requirements.size : (requirements.size + atomSize - 1) / atomSize * atomSize;
+      bool expectDedicated = lazy || effectiveSize >= blockSize / 2;
+      LVE_CHECK(allocation.dedicated == expectDedicated);
+      if (allocation.dedicated) {
+        LVE_CHECK(allocation.offset == 0);
+        LVE_CHECK(ranges.count(allocation.memory) == 0);
+      } else {
+        LVE_CHECK(allocation.offset + allocation.size <= blockSize);
+      }
+
+      // no overlap with the live neighbours in the same VkDeviceMemory
+      auto &memoryRanges = ranges[allocation.memory];
+      auto next = memoryRanges.lower_bound(allocation.offset);
+      if (next != memoryRanges.end()) {
+        LVE_CHECK(allocation.offset + allocation.size <= next->first);
+      }
+      if (next != memoryRanges.begin()) {
+        LVE_CHECK(std::prev(next)->second <= allocation.offset);
+      }
+      memoryRanges[allocation.offset] = allocation.offset + allocation.size;
+
+      LVE_CHECK((allocation.mappedData != nullptr) == hostVisible);
+      uint8_t pattern = nextPattern++;
+      if (nextPattern == 0) nextPattern = 1;
+      if (allocation.mappedData != nullptr) {
+        const char *base = static_cast<const char *>(allocation.mappedData) - allocation.offset;
+        auto [it, inserted] = mappedBases.emplace(allocation.memory, base);
+        LVE_CHECK(it->second == base);
+
+        uint8_t *bytes = static_cast<uint8_t *>(allocation.mappedData);
+        VkDeviceSize written = std::min<VkDeviceSize>(requirements.size, 64);
+        std::memset(bytes, pattern, written);
+        std::memset(bytes + requirements.size - written, pattern, written);
+
+        // a random sub-range must be covered by atom-aligned bounds, inside the allocation when
+        // the memory is not coherent
+        VkDeviceSize offset = static_cast<VkDeviceSize>(unit(rng) * requirements.size) % requirements.size;
+        VkDeviceSize size = 1 + static_cast<VkDeviceSize>(unit(rng) * (requirements.size - offset)) % (requirements.size - offset);
+        VkMappedMemoryRange range = allocator.makeMappedRange(allocation, offset, size);
+        LVE_CHECK(range.memory == allocation.memory);
+        LVE_CHECK(range.offset % atomSize == 0 && range.size % atomSize == 0);
+        LVE_CHECK(range.offset <= allocation.offset + offset);
+        LVE_CHECK(range.offset + range.size >= allocation.offset + offset + size);
+        VkMappedMemoryRange whole = allocator.makeMappedRange(allocation, 0, VK_WHOLE_SIZE);
+        LVE_CHECK(whole.offset + whole.size >= allocation.offset + allocation.size);
+        if (!coherent) {
+          LVE_CHECK(range.offset >= allocation.offset);
+          LVE_CHECK(range.offset + range.size <= allocation.offset + allocation.size);
+          LVE_CHECK(whole.offset == allocation.offset && whole.size == allocation.size);
+        }
+        LVE_CHECK(allocator.flush(allocation, offset, size) == VK_SUCCESS);
+        LVE_CHECK(allocator.invalidate(allocation, offset, size) == VK_SUCCESS);
+      }
+
+      live.push_back({allocation, requirements.size, pattern});
+      liveBytes += allocation.size;
+
+      if (iteration % 1000 == 0) {
+        allocator.updateBudget();
+        LveAllocator::Stats stats = allocator.getStats();
+        LVE_CHECK(stats.allocationCount + stats.dedicatedAllocationCount == live.size());
+        LVE_CHECK(stats.deviceMemoryCount == stats.blockCount + stats.dedicatedAllocationCount);
+        LVE_CHECK(stats.usedBlockBytes <= stats.blockBytes);
+      }
+    }
+
+    std::cout << "  peak pools: " << allocator.getStats().blockCount << " blocks, "
+              << allocator.getStats().dedicatedAllocationCount << " dedicated allocations live before draining"
+              << std::endl;
+    while (!live.empty()) {
+      release(live.size() - 1);
+    }
+
+    // one block per used pool may stay behind, empty
+    LveAllocator::Stats stats = allocator.getStats();
+    LVE_CHECK(stats.allocationCount == 0);
+    LVE_CHECK(stats.dedicatedAllocationCount == 0);
+    LVE_CHECK(stats.dedicatedBytes == 0);
+    LVE_CHECK(stats.usedBlockBytes == 0);
+    LVE_CHECK(stats.blockCount <= 2 * memoryTypes.size());
+    LVE_CHECK(stats.deviceMemoryCount == stats.blockCount);
+    for (const auto &heap : allocator.getHeapBudgets()) {
+      for (VkDeviceSize bytes : heap.categoryBytes) {
+        LVE_CHECK(bytes == 0);
+      }
+    }
+  }
+
+  LVE_CHECK(testDevice.getValidationErrorCount() == 0);
+}
+
+}  // namespace lve
@@ -0,0 +1,155 @@
+#include "lve_render_queue.hpp"
+#include "lve_test.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+// Pushes the keys in order, sorts the queue and compares it with std::stable_sort of the same
+// entries, item indices included, so a sort that is not stable fails on duplicate keys
+void checkSort(const std::vector<uint64_t> &keys) {
+  LveRenderQueue queue;
+  std::vector<LveRenderQueue::Entry> expected;
+  for (uint32_t i = 0; i < keys.size(); i++) {
+    queue.push(keys[i], i);
+    expected.push_back({keys[i], i});
+  }
+  std::stable_sort(expected.begin(), expected.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+
+  // the second sort starts from sorted entries and warm scratch space, as in a steady frame
+  for (int pass = 0; pass < 2; pass++) {
+    queue.sort();
+    LVE_CHECK(queue.size() == expected.size());
+    bool matches = queue.size() == expected.size();
+    for (size_t i = 0; matches && i < expected.size(); i++) {
+      matches = queue[i].key == expected[i].key && queue[i].item == expected[i].item;
+    }
+    LVE_CHECK(matches);
+  }
+}
+
+std::vector<uint64_t> makeSceneKeys(uint32_t count, uint32_t seed) {
+  std::mt19937 rng{seed};
+  std::uniform_real_distribution<float> distance{0.f, 60.f};
+  std::vector<uint64_t> keys(count);
+  for (auto &key : keys) {
+    key = LveRenderQueue::makeKey(rng() % 2, distance(rng), rng() % 50, rng() % 4, 0);
+  }
+  return keys;
+}
+
+}  // namespace
+
+LVE_TEST(renderQueueMatchesStableSort) {
+  std::mt19937_64 rng{5};
+  for (uint32_t count : {0u, 1u, 2u, 17u, 1000u, 100000u}) {
+    // every byte varies
+    std::vector<uint64_t> keys(count);
+    for (auto &key : keys) {
+      key = rng();
+    }
+    checkSort(keys);
+
+    // few distinct keys, so most of them are duplicates
+    for (auto &key : keys) {
+      key = (rng() % 8) * 0x0101010101010101ull;
+    }
+    checkSort(keys);
+
+    checkSort(makeSceneKeys(count, count));
+  }
+}
+
+// Digits that are equal in every key are skipped; an odd number of sorted digits leaves the result
+// in the scratch buffer, an even number in place, and none at all keeps push order
+LVE_TEST(renderQueueSkipsConstantDigits) {
+  std::mt19937_64 rng{9};
+  const uint64_t base = 0x0123456789abcdefull;
+  for (uint32_t count : {2u, 300u, 70000u}) {
+    std::vector<uint64_t> keys(count, base);
+    checkSort(keys);
+
+    // only byte 3 varies
+    for (auto &key : keys) {
+      key = (base & ~0xff000000ull) | ((rng() & 0xff) << 24);
+    }
+    checkSort(keys);
+
+    // bytes 0 and 7 vary
+    for (auto &key : keys) {
+      key = (base & 0x00ffffffffffff00ull) | (rng() & 0xff) | ((rng() & 0xff) << 56);
+    }
+    checkSort(keys);
+
+    // bytes 1, 4 and 6 vary
+    for (auto &key : keys) {
+      key = (base & 0xff00ff00ffff00ffull) | (rng() & 0x00ff00ff0000ff00ull);
+    }
+    checkSort(keys);
+  }
+}
+
+LVE_TEST(renderQueueKeyLayout) {
+  // each field outranks everything below it, whatever the lower fields hold
+  LVE_CHECK(LveRenderQueue::makeKey(0, 1000.f, 0xfffff, 15, 255) < LveRenderQueue::makeKey(1, 0.f, 0, 0, 0));
+  LVE_CHECK(LveRenderQueue::makeKey(0, 1.9f, 0xfffff, 15, 255) < LveRenderQueue::makeKey(0, 2.f, 0, 0, 0));
+  LVE_CHECK(LveRenderQueue::makeKey(0, 3.9f, 1, 15, 255) < LveRenderQueue::makeKey(0, 2.f, 2, 0, 0));
+  LVE_CHECK(LveRenderQueue::makeKey(0, 3.9f, 1, 1, 255) < LveRenderQueue::makeKey(0, 2.f, 1, 2, 0));
+  LVE_CHECK(LveRenderQueue::makeKey(0, 3.9f, 1, 1, 1) < LveRenderQueue::makeKey(0, 2.f, 1, 1, 2));
+
+  // within a band, draws of one model stay adjacent and go front to back
+  uint64_t previous = 0;
+  bool monotonic = true;
+  for (float distance = 0.f; distance < 1000.f; distance += 0.01f) {
+    uint64_t key = LveRenderQueue::makeKey(0, distance, 7, 0, 0);
+    monotonic &= key >= previous;
+    previous = key;
+  }
+  LVE_CHECK(monotonic);
+  LVE_CHECK((LveRenderQueue::makeKey(0, 2.f, 0, 0, 0) >> 56) == (LveRenderQueue::makeKey(0, 3.99f, 0, 0, 0) >> 56));
+  LVE_CHECK((LveRenderQueue::makeKey(0, 3.99f, 0, 0, 0) >> 56) != (LveRenderQueue::makeKey(0, 4.f, 0, 0, 0) >> 56));
+
+  // negative distances clamp to zero and ids wider than their field wrap
+  LVE_CHECK(LveRenderQueue::makeKey(0, -5.f, 0, 0, 0) == LveRenderQueue::makeKey(0, 0.f, 0, 0, 0));
+  LVE_CHECK(LveRenderQueue::makeKey(0, 1.f, 0x100003, 0, 0) == LveRenderQueue::makeKey(0, 1.f, 3, 0, 0));
+}
+
+// Re-sorting a warm queue of scene keys, against std::stable_sort on the same entries
+LVE_BENCHMARK(renderQueueSort) {
+  for (uint32_t count : {1000u, 10000u, 100000u}) {
+    const std::vector<uint64_t> keys = makeSceneKeys(count, 1);
+    LveRenderQueue queue;
+    std::vector<LveRenderQueue::Entry> entries;
+    double bestRadix = 1e30;
+    double bestStable = 1e30;
+    for (int pass = 0; pass < 20; pass++) {
+      queue.clear();
+      entries.clear();
+      for (uint32_t i = 0; i < count; i++) {
+        queue.push(keys[i], i);
+        entries.push_back({keys[i], i});
+      }
+
+      auto start = std::chrono::high_resolution_clock::now();
+      queue.sort();
+      auto end = std::chrono::high_resolution_clock::now();
+      bestRadix = std::min(bestRadix, std::chrono::duration<double, std::milli>(end - start).count());
+
+      start = std::chrono::high_resolution_clock::now();
+      std::stable_sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+      end = std::chrono::high_resolution_clock::now();
+      bestStable = std::min(bestStable, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::cout << "  " << count << " draws: radix " << bestRadix << " ms, std::stable_sort " << bestStable
+              << " ms, best of 20" << std::endl;
+  }
+}
+
+}  // namespace lve
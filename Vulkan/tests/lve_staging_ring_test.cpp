@@ -0,0 +1,132 @@
+#include "lve_staging_ring.hpp"
+#include "lve_test.hpp"
+
+// std
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+struct Range {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct ClosedBatch {
+  std::vector<Range> ranges;
+  uint64_t bytes;
+};
+
+bool overlaps(const Range &a, const Range &b) { return a.offset < b.offset + b.size && b.offset < a.offset + a.size; }
+
+}  // namespace
+
+// Records batches of random copies the way LveUploadContext does: allocate, close the batch on
+// submit, release the oldest batch when the ring runs full. Every allocation has to stay clear
+// of the ranges still in flight, and once all batches are released the ring has to be empty
+// again and start over at offset 0
+LVE_TEST(stagingRingDrainsAfterManyBatches) {
+  const uint64_t ringSize = 64 * 1024;
+  const uint64_t alignment = 16;
+  LveStagingRing ring{ringSize};
+  std::mt19937 rng{3};
+  std::uniform_int_distribution<uint64_t> copySize{1, ringSize / 4};
+  std::uniform_int_distribution<uint32_t> copiesPerBatch{1, 6};
+
+  std::deque<ClosedBatch> inFlight;
+  uint64_t stalls = 0;
+  for (uint32_t batch = 0; batch < 5000; batch++) {
+    std::vector<Range> open;
+    uint32_t copyCount = copiesPerBatch(rng);
+    for (uint32_t copy = 0; copy < copyCount; copy++) {
+      const uint64_t size = copySize(rng);
+      uint64_t offset = 0;
+      while (!ring.allocate(size, alignment, offset)) {
+        // the open batch is submitted and the oldest waited for, as allocateStaging does
+        stalls++;
+        if (!open.empty()) {
+          inFlight.push_back({open, ring.closeBatch()});
+          open.clear();
+        }
+        LVE_CHECK(!inFlight.empty());
+        if (inFlight.empty()) {
+          return;
+        }
+        ring.release(inFlight.front().bytes);
+        inFlight.pop_front();
+      }
+
+      const Range range{offset, size};
+      LVE_CHECK(offset % alignment == 0);
+      LVE_CHECK_LE(offset + size, ringSize);
+      bool clear = true;
+      for (const auto &closed : inFlight) {
+        for (const auto &other : closed.ranges) {
+          clear &= !overlaps(range, other);
+        }
+      }
+      for (const auto &other : open) {
+        clear &= !overlaps(range, other);
+      }
+      LVE_CHECK(clear);
+      open.push_back(range);
+    }
+    if (!open.empty()) {
+      inFlight.push_back({open, ring.closeBatch()});
+    }
+    LVE_CHECK(ring.getOpenBatchBytes() == 0);
+  }
+  LVE_CHECK(stalls > 0);
+
+  while (!inFlight.empty()) {
+    ring.release(inFlight.front().bytes);
+    inFlight.pop_front();
+  }
+  LVE_CHECK(ring.getUsedBytes() == 0);
+  uint64_t offset = 1;
+  LVE_CHECK(ring.allocate(ringSize, alignment, offset));
+  LVE_CHECK(offset == 0);
+}
+
+// An allocation that does not fit before the end of the ring starts over at 0, and the skipped
+// tail is charged to the open batch, so releasing every batch empties the ring exactly
+LVE_TEST(stagingRingChargesSkippedTailToOpenBatch) {
+  LveStagingRing ring{1024};
+  uint64_t offset = 0;
+  LVE_CHECK(ring.allocate(300, 16, offset) && offset == 0);
+  LVE_CHECK(ring.allocate(500, 16, offset) && offset == 304);
+  const uint64_t first = ring.closeBatch();
+  LVE_CHECK(first == 816);
+
+  LVE_CHECK(ring.allocate(100, 16, offset) && offset == 816);
+  const uint64_t second = ring.closeBatch();
+  LVE_CHECK(second == 112);
+
+  // 96 bytes are left at the end; 208 only fit at the front, which the first batch still holds
+  LVE_CHECK(!ring.allocate(200, 16, offset));
+  ring.release(first);
+  LVE_CHECK(ring.allocate(200, 16, offset) && offset == 0);
+  LVE_CHECK(ring.getOpenBatchBytes() == 96 + 208);
+  const uint64_t third = ring.closeBatch();
+
+  ring.release(second);
+  ring.release(third);
+  LVE_CHECK(ring.getUsedBytes() == 0);
+
+  // a batch ending exactly at the end of the ring leaves nothing to skip, but still wraps
+  LVE_CHECK(ring.allocate(512, 16, offset) && offset == 0);
+  const uint64_t fourth = ring.closeBatch();
+  LVE_CHECK(ring.allocate(512, 16, offset) && offset == 512);
+  const uint64_t fifth = ring.closeBatch();
+  ring.release(fourth);
+  LVE_CHECK(ring.allocate(16, 16, offset) && offset == 0);
+  ring.release(fifth);
+  ring.release(ring.closeBatch());
+  LVE_CHECK(ring.getUsedBytes() == 0);
+  LVE_CHECK(ring.allocate(1024, 16, offset) && offset == 0);
+}
+
+}  // namespace lve
@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal test registry for the LveTests executable. Tests run by default; benchmarks only when
+// named on the command line or with --benchmarks, since they take seconds and print timings
+// rather than pass or fail on them.
+namespace lve::test {
+
+struct TestCase {
+  const char *name;
+  void (*run)();
+  bool benchmark;
+};
+
+std::vector<TestCase> &registry();
+
+struct Registrar {
+  Registrar(const char *name, void (*run)(), bool benchmark) { registry().push_back({name, run, benchmark}); }
+};
+
+// Records a failed check; the test keeps running so one run reports every broken case
+void fail(const char *file, int line, const std::string &message);
+
+}  // namespace lve::test
+
+#define LVE_TEST(name)                                                 \
+  static void name();                                                  \
+  static lve::test::Registrar name##Registrar{#name, name, false};     \
+  static void name()
+
+#define LVE_BENCHMARK(name)                                            \
+  static void name();                                                  \
+  static lve::test::Registrar name##Registrar{#name, name, true};      \
+  static void name()
+
+#define LVE_CHECK(expr)                                                \
+  do {                                                                 \
+    if (!(expr)) lve::test::fail(__FILE__, __LINE__, #expr);           \
+  } while (0)
+
+// Checks actual <= bound and reports both values on failure
+#define LVE_CHECK_LE(actual, bound)                                                     \
+  do {                                                                                  \
+    auto lveActual = (actual);                                                          \
+    auto lveBound = (bound);                                                            \
+    if (!(lveActual <= lveBound)) {                                                     \
+      std::ostringstream lveMessage;                                                    \
+      lveMessage << #actual " <= " #bound " (" << lveActual << " > " << lveBound << ")"; \
+      lve::test::fail(__FILE__, __LINE__, lveMessage.str());                            \
+    }                                                                                   \
+  } while (0)
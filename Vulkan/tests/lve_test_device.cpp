@@ -0,0 +1,161 @@
+#include "lve_test_device.hpp"
+
+// std
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace lve::test {
+
+namespace {
+
+const char *VALIDATION_LAYER = "VK_LAYER_KHRONOS_validation";
+
+bool hasLayer(const char *name) {
+  uint32_t count = 0;
+  vkEnumerateInstanceLayerProperties(&count, nullptr);
+  std::vector<VkLayerProperties> layers(count);
+  vkEnumerateInstanceLayerProperties(&count, layers.data());
+  for (const auto &layer : layers) {
+    if (std::strcmp(layer.layerName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char *name) {
+  uint32_t count = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+  std::vector<VkExtensionProperties> extensions(count);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, extensions.data());
+  for (const auto &extension : extensions) {
+    if (std::strcmp(extension.extensionName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+LveTestDevice::LveTestDevice() {
+  bool validation = hasLayer(VALIDATION_LAYER);
+
+  VkApplicationInfo appInfo{};
+  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  appInfo.pApplicationName = "LveTests";
+  appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+  appInfo.pEngineName = "No Engine";
+  appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+  appInfo.apiVersion = VK_API_VERSION_1_2;
+
+  const char *debugExtension = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+  VkInstanceCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  createInfo.pApplicationInfo = &appInfo;
+  if (validation) {
+    createInfo.enabledLayerCount = 1;
+    createInfo.ppEnabledLayerNames = &VALIDATION_LAYER;
+    createInfo.enabledExtensionCount = 1;
+    createInfo.ppEnabledExtensionNames = &debugExtension;
+  }
+  if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create instance!");
+  }
+
+  if (validation) {
+    VkDebugUtilsMessengerCreateInfoEXT messengerInfo{};
+    messengerInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    messengerInfo.messageSeverity =
+        VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    messengerInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                                VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                                VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    messengerInfo.pfnUserCallback = debugCallback;
+    messengerInfo.pUserData = this;
+    auto createMessenger = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
+        instance,
+        "vkCreateDebugUtilsMessengerEXT");
+    if (createMessenger != nullptr) {
+      createMessenger(instance, &messengerInfo, nullptr, &debugMessenger);
+    }
+  }
+
+  uint32_t deviceCount = 0;
+  vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+  if (deviceCount == 0) {
+    throw std::runtime_error("failed to find GPUs with Vulkan support!");
+  }
+  std::vector<VkPhysicalDevice> devices(deviceCount);
+  vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+  physical = devices[0];
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical, &properties);
+  std::cout << "test device: " << properties.deviceName << (validation ? ", validation on" : ", validation off")
+            << std::endl;
+
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physical, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physical, &familyCount, families.data());
+  graphicsFamily = familyCount;
+  for (uint32_t i = 0; i < familyCount; i++) {
+    if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+      graphicsFamily = i;
+      break;
+    }
+  }
+  if (graphicsFamily == familyCount) {
+    throw std::runtime_error("failed to find a graphics queue!");
+  }
+
+  float priority = 1.f;
+  VkDeviceQueueCreateInfo queueInfo{};
+  queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueInfo.queueFamilyIndex = graphicsFamily;
+  queueInfo.queueCount = 1;
+  queueInfo.pQueuePriorities = &priority;
+
+  memoryBudget = hasDeviceExtension(physical, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  const char *budgetExtension = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+  VkDeviceCreateInfo deviceInfo{};
+  deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceInfo.queueCreateInfoCount = 1;
+  deviceInfo.pQueueCreateInfos = &queueInfo;
+  deviceInfo.enabledExtensionCount = memoryBudget ? 1 : 0;
+  deviceInfo.ppEnabledExtensionNames = &budgetExtension;
+  if (vkCreateDevice(physical, &deviceInfo, nullptr, &logical) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create logical device!");
+  }
+  vkGetDeviceQueue(logical, graphicsFamily, 0, &graphicsQueue);
+}
+
+LveTestDevice::~LveTestDevice() {
+  vkDestroyDevice(logical, nullptr);
+  if (debugMessenger != VK_NULL_HANDLE) {
+    auto destroyMessenger = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
+        instance,
+        "vkDestroyDebugUtilsMessengerEXT");
+    if (destroyMessenger != nullptr) {
+      destroyMessenger(instance, debugMessenger, nullptr);
+    }
+  }
+  vkDestroyInstance(instance, nullptr);
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL LveTestDevice::debugCallback(
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+    void *pUserData) {
+  std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+  if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+    static_cast<LveTestDevice *>(pUserData)->validationErrorCount++;
+  }
+  return VK_FALSE;
+}
+
+}  // namespace lve::test
@@ -0,0 +1,50 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+
+namespace lve::test {
+
+// Headless Vulkan device for tests: no window or surface, one graphics queue, validation enabled
+// when the layer is installed. Uses the first physical device the loader reports, so a software
+// driver is picked by pointing the loader at it only, e.g. on Linux
+//   VK_DRIVER_FILES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./LveTests
+// (VK_ICD_FILENAMES on loaders older than 1.3.234).
+class LveTestDevice {
+ public:
+  LveTestDevice();
+  ~LveTestDevice();
+
+  LveTestDevice(const LveTestDevice &) = delete;
+  LveTestDevice &operator=(const LveTestDevice &) = delete;
+
+  VkPhysicalDevice physicalDevice() const { return physical; }
+  VkDevice device() const { return logical; }
+  VkQueue queue() const { return graphicsQueue; }
+  uint32_t queueFamily() const { return graphicsFamily; }
+  bool memoryBudgetSupported() const { return memoryBudget; }
+
+  // Validation errors reported since construction
+  uint32_t getValidationErrorCount() const { return validationErrorCount; }
+
+ private:
+  static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
+      VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+      VkDebugUtilsMessageTypeFlagsEXT messageType,
+      const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+      void *pUserData);
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+  VkPhysicalDevice physical = VK_NULL_HANDLE;
+  VkDevice logical = VK_NULL_HANDLE;
+  VkQueue graphicsQueue = VK_NULL_HANDLE;
+  uint32_t graphicsFamily = 0;
+  bool memoryBudget = false;
+  uint32_t validationErrorCount = 0;
+};
+
+}  // namespace lve::test
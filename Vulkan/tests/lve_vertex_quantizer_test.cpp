@@ -0,0 +1,158 @@
+#include "lve_test.hpp"
+#include "lve_vertex_quantizer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace lve {
+
+namespace {
+
+struct TestVertex {
+  glm::vec3 position;
+  glm::vec3 color;
+  glm::vec3 normal;
+  glm::vec2 uv;
+};
+
+// Encodes every vertex with a quantizer fitted to the mesh bounds, as LveModel::Builder does, and
+// checks the decoded attributes against getErrorBound()
+void checkRoundTrip(const std::vector<TestVertex> &mesh) {
+  glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+  glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+  float uvRange = 0.f;
+  for (const auto &vertex : mesh) {
+    boundsMin = glm::min(boundsMin, vertex.position);
+    boundsMax = glm::max(boundsMax, vertex.position);
+    uvRange = std::max({uvRange, std::abs(vertex.uv.x), std::abs(vertex.uv.y)});
+  }
+  LveVertexQuantizer quantizer{boundsMin, boundsMax};
+  const LveVertexQuantizer::Error bound = quantizer.getErrorBound(uvRange);
+
+  for (const auto &vertex : mesh) {
+    glm::vec3 position, color, normal;
+    glm::vec2 uv;
+    quantizer.decode(quantizer.encode(vertex.position, vertex.color, vertex.normal, vertex.uv), position, color, normal, uv);
+
+    LVE_CHECK_LE(glm::length(position - vertex.position), bound.position);
+    // the matrix the vertex shader applies to the unorm position lands in the same place
+    LveCompactVertex encoded = quantizer.encode(vertex.position, vertex.color, vertex.normal, vertex.uv);
+    glm::vec4 unorm{encoded.position[0] / 65535.f, encoded.position[1] / 65535.f, encoded.position[2] / 65535.f, 1.f};
+    LVE_CHECK_LE(glm::length(glm::vec3{quantizer.getDequantizationMatrix() * unorm} - vertex.position), bound.position);
+
+    float normalLength = glm::length(vertex.normal);
+    LVE_CHECK(std::isfinite(normal.x) && std::isfinite(normal.y) && std::isfinite(normal.z));
+    LVE_CHECK_LE(std::abs(glm::length(normal) - 1.f), 1e-5f);
+    if (normalLength > 0.f) {
+      float cosine = std::clamp(glm::dot(normal, vertex.normal / normalLength), -1.f, 1.f);
+      LVE_CHECK_LE(std::acos(cosine), bound.normal);
+    }
+
+    LVE_CHECK_LE(std::abs(uv.x - vertex.uv.x), bound.uv);
+    LVE_CHECK_LE(std::abs(uv.y - vertex.uv.y), bound.uv);
+    for (int i = 0; i < 3; i++) {
+      LVE_CHECK_LE(std::abs(color[i] - std::clamp(vertex.color[i], 0.f, 1.f)), bound.color);
+    }
+  }
+}
+
+std::vector<TestVertex> randomMesh(
+    std::mt19937 &rng, glm::vec3 boundsMin, glm::vec3 boundsMax, float uvRange, size_t count) {
+  std::uniform_real_distribution<float> unit{0.f, 1.f};
+  std::uniform_real_distribution<float> signedUnit{-1.f, 1.f};
+  std::vector<TestVertex> mesh(count);
+  for (auto &vertex : mesh) {
+    vertex.position = boundsMin + (boundsMax - boundsMin) * glm::vec3{unit(rng), unit(rng), unit(rng)};
+    vertex.color = {unit(rng), unit(rng), unit(rng)};
+    vertex.normal = {signedUnit(rng), signedUnit(rng), signedUnit(rng)};
+    vertex.uv = {signedUnit(rng) * uvRange, signedUnit(rng) * uvRange};
+  }
+  // the corners pin the bounds exactly
+  mesh.front().position = boundsMin;
+  mesh.back().position = boundsMax;
+  return mesh;
+}
+
+}  // namespace
+
+LVE_TEST(vertexQuantizerUnitCube) {
+  std::mt19937 rng{1};
+  checkRoundTrip(randomMesh(rng, glm::vec3{-.5f}, glm::vec3{.5f}, 1.f, 100000));
+}
+
+LVE_TEST(vertexQuantizerExtremeBounds) {
+  std::mt19937 rng{2};
+  // kilometre-sized terrain
+  checkRoundTrip(randomMesh(rng, glm::vec3{-5000.f, -20.f, -5000.f}, glm::vec3{5000.f, 800.f, 5000.f}, 1.f, 50000));
+  // a millimetre-sized part far from the origin, where float spacing dominates the 16-bit step
+  checkRoundTrip(randomMesh(rng, glm::vec3{1.e4f, 1.e4f, -1.e4f}, glm::vec3{1.e4f + .001f, 1.e4f + .001f, -1.e4f + .001f}, 1.f, 50000));
+  // flat along y, as for a ground plane
+  checkRoundTrip(randomMesh(rng, glm::vec3{-10.f, 0.f, -10.f}, glm::vec3{10.f, 0.f, 10.f}, 1.f, 50000));
+  // a single point
+  checkRoundTrip({{glm::vec3{3.f, -2.f, 7.f}, glm::vec3{.2f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{.5f}}});
+}
+
+LVE_TEST(vertexQuantizerDegenerateNormals) {
+  std::vector<TestVertex> mesh;
+  const glm::vec3 normals[] = {
+      {0.f, 0.f, 0.f},  // missing normal: decodes to some unit vector, no error to measure
+      {1.f, 0.f, 0.f},
+      {-1.f, 0.f, 0.f},
+      {0.f, 1.f, 0.f},
+      {0.f, -1.f, 0.f},
+      {0.f, 0.f, 1.f},
+      {0.f, 0.f, -1.f},  // the octahedron's folded corner
+      {1.f, 1.f, 0.f},   // on the fold seam
+      {-1.f, 0.f, -1.e-7f},
+      {1.e-20f, -1.e-20f, 1.e-20f},  // denormal-small but non-zero
+      {250.f, -40.f, 3.f},           // unnormalized
+      {0.f, 0.f, -1.e-30f},
+  };
+  for (const auto &normal : normals) {
+    mesh.push_back({glm::vec3{static_cast<float>(mesh.size())}, glm::vec3{.5f}, normal, glm::vec2{0.f}});
+  }
+  checkRoundTrip(mesh);
+}
+
+LVE_TEST(vertexQuantizerUvOutsideUnitRange) {
+  std::mt19937 rng{3};
+  // tiling textures and negative coordinates
+  checkRoundTrip(randomMesh(rng, glm::vec3{-1.f}, glm::vec3{1.f}, 8.f, 50000));
+  checkRoundTrip(randomMesh(rng, glm::vec3{-1.f}, glm::vec3{1.f}, 1000.f, 50000));
+  std::vector<TestVertex> mesh = {
+      {glm::vec3{0.f}, glm::vec3{0.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{-1.f, 2.f}},
+      {glm::vec3{1.f}, glm::vec3{1.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{1.e-6f, -3.99f}},
+      {glm::vec3{2.f}, glm::vec3{1.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{4.f, 0.f}},
+  };
+  checkRoundTrip(mesh);
+}
+
+LVE_TEST(vertexQuantizerColorRange) {
+  // out-of-range colors clamp, which the bound measures against the clamped input
+  std::vector<TestVertex> mesh = {
+      {glm::vec3{0.f}, glm::vec3{0.f, 1.f, .5f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{0.f}},
+      {glm::vec3{1.f}, glm::vec3{-.25f, 1.5f, 1.f / 255.f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{0.f}},
+      {glm::vec3{2.f}, glm::vec3{.5f / 255.f, 254.5f / 255.f, .999f}, glm::vec3{0.f, 1.f, 0.f}, glm::vec2{0.f}},
+  };
+  checkRoundTrip(mesh);
+}
+
+LVE_TEST(vertexQuantizerHalfFloat) {
+  // every half value survives half -> float -> half
+  for (uint32_t half = 0; half < 0x10000u; half++) {
+    float value = LveVertexQuantizer::halfToFloat(static_cast<uint16_t>(half));
+    if (!std::isnan(value)) {
+      LVE_CHECK(LveVertexQuantizer::floatToHalf(value) == half);
+    }
+  }
+  LVE_CHECK(LveVertexQuantizer::floatToHalf(65520.f) == 0x7c00u);  // rounds up to infinity
+  LVE_CHECK(LveVertexQuantizer::floatToHalf(1.f + 1.f / 2048.f) == 0x3c00u);  // ties to even
+  LVE_CHECK(LveVertexQuantizer::floatToHalf(1.f + 3.f / 2048.f) == 0x3c02u);
+  LVE_CHECK(LveVertexQuantizer::halfToFloat(0x0001u) == std::ldexp(1.f, -24));
+}
+
+}  // namespace lve
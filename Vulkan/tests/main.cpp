@@ -0,0 +1,70 @@
+#include "lve_test.hpp"
+
+// std
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace lve::test {
+
+static int failureCount = 0;
+
+std::vector<TestCase> &registry() {
+  static std::vector<TestCase> testCases;
+  return testCases;
+}
+
+void fail(const char *file, int line, const std::string &message) {
+  std::cerr << file << ":" << line << ": check failed: " << message << '\n';
+  failureCount++;
+}
+
+}  // namespace lve::test
+
+// usage: LveTests [--benchmarks] [name...]
+// With no names every test runs; --benchmarks adds every benchmark.
+int main(int argc, char **argv) {
+  using namespace lve::test;
+
+  bool benchmarks = false;
+  std::vector<std::string> names;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--benchmarks") == 0) {
+      benchmarks = true;
+    } else {
+      names.push_back(argv[i]);
+    }
+  }
+
+  int runCount = 0;
+  int failedTestCount = 0;
+  for (const TestCase &testCase : registry()) {
+    bool selected = false;
+    for (const auto &name : names) {
+      selected |= name == testCase.name;
+    }
+    if (!selected && (!names.empty() || (testCase.benchmark && !benchmarks))) {
+      continue;
+    }
+
+    std::cout << "[ run  ] " << testCase.name << std::endl;
+    int failuresBefore = failureCount;
+    try {
+      testCase.run();
+    } catch (const std::exception &e) {
+      fail(testCase.name, 0, std::string{"exception: "} + e.what());
+    }
+    bool passed = failureCount == failuresBefore;
+    std::cout << (passed ? "[  ok  ] " : "[ FAIL ] ") << testCase.name << std::endl;
+    runCount++;
+    failedTestCount += passed ? 0 : 1;
+  }
+
+  if (runCount == 0) {
+    std::cerr << "no test matched\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << runCount - failedTestCount << " of " << runCount << " passed" << std::endl;
+  return failedTestCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}